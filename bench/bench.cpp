@@ -0,0 +1,313 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#include "../libutils/src/benchmark.hpp"
+#include "../libutils/src/cliparser.hpp"
+#include "../libutils/src/funcs.hpp"
+#include "../libutils/src/random.hpp"
+#include "../libutils/src/simd.hpp"
+#include "../libutils/src/table.hpp"
+
+#include "../src/matcher.hpp"
+#include "../src/scanner.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+/* Search-kernel benchmarks, run with `make bench` (or `make bench BENCH_ARGS="--size 64 --time 0.2 --csv out.csv"`).
+ * Every corpus is generated from a fixed seed, so numbers from different releases on the same box compare.
+ * For each corpus, needle length and planted hit density it times:
+ *   find      funcs::findSequence over the whole corpus, every occurrence (the raw SIMD search)
+ *   scan      LineSearcher with a LiteralMatcher, what a plain search of a file does
+ *   scan -i   the same with -i
+ *   count     scanner::countBlock, what -c does
+ * Every point is CBenchmark::m_measure'd (warmup, then --samples samples over --time seconds).
+ * GB/s and lines/s come from the median, "spread" is the MAD as a % of it: differences smaller
+ * than that between two runs are noise. cycles/B is the median in CycleCounter's calibrated TSC ticks
+ * (the nominal clock, turbo doesn't change it) per byte of corpus. With --counters the samples also run under
+ * the hardware counters (CPerfCounters) and IPC, instructions per byte and misses per KB show up, when the box has them. ns/match is what a hit adds on top of the same search
+ * with no hits planted (when there are enough hits to tell). */
+
+namespace
+{
+struct Corpus
+{
+	std::string m_name;
+	std::string m_text;
+	uint64_t m_lines = 0;
+};
+
+std::string randomWord(size_t min_length, size_t max_length)
+{
+	std::string word(Random::m_int(min_length, max_length), ' ');
+	for (char &c : word)
+		c = static_cast<char>('a' + Random::m_int(0, 25));
+	return word;
+}
+
+// lowercase words of 2-10 letters, a few hundred distinct ones like real prose
+Corpus makeText(size_t size)
+{
+	std::vector<std::string> words;
+	for (size_t i = 0; i < 500; i++)
+		words.push_back(randomWord(2, 10));
+	Corpus corpus{"text", {}, 0};
+	while (corpus.m_text.size() < size)
+	{
+		const uint64_t count = Random::m_int(5, 15);
+		for (uint64_t i = 0; i < count; i++)
+		{
+			if (i != 0)
+				corpus.m_text += ' ';
+			corpus.m_text += Random::m_getFrom(words);
+		}
+		corpus.m_text += '\n';
+	}
+	return corpus;
+}
+
+Corpus makeLogs(size_t size)
+{
+	const std::vector<std::string> levels = {"INFO", "INFO", "INFO", "DEBUG", "DEBUG", "WARN", "ERROR"};
+	const std::vector<std::string> messages = {"request served", "cache miss", "connection reset by peer", "retrying upstream",
+											   "user logged in", "slow query", "queue depth above threshold", "gc pause"};
+	const std::vector<std::string> paths = {"/api/v1/users", "/api/v1/orders", "/static/app.js", "/healthz", "/api/v2/search"};
+	Corpus corpus{"logs", {}, 0};
+	char stamp[64];
+	uint64_t millis = 0;
+	while (corpus.m_text.size() < size)
+	{
+		millis += Random::m_int(0, 50);
+		std::snprintf(stamp, sizeof(stamp), "2026-10-17T%02u:%02u:%02u.%03uZ ", static_cast<unsigned>(millis / 3600000 % 24),
+					  static_cast<unsigned>(millis / 60000 % 60), static_cast<unsigned>(millis / 1000 % 60), static_cast<unsigned>(millis % 1000));
+		corpus.m_text += stamp;
+		corpus.m_text += Random::m_getFrom(levels);
+		corpus.m_text += " [worker-" + std::to_string(Random::m_int(0, 15)) + "] ";
+		corpus.m_text += Random::m_getFrom(messages);
+		corpus.m_text += " path=" + Random::m_getFrom(paths) + " id=" + randomWord(12, 12);
+		corpus.m_text += " took=" + std::to_string(Random::m_int(0, 2000)) + "ms\n";
+	}
+	return corpus;
+}
+
+Corpus makeSource(size_t size)
+{
+	const std::vector<std::string> keywords = {"if", "for", "return", "const", "auto", "static", "inline", "while", "std::string", "size_t", "nullptr"};
+	const std::vector<std::string> symbols = {"(", ")", "{", "}", ";", "=", "==", "+", "->", "::", "<", ">", ",", "&&"};
+	std::vector<std::string> identifiers;
+	for (size_t i = 0; i < 300; i++)
+		identifiers.push_back(randomWord(3, 8) + (Random::m_bool() ? "_" + randomWord(2, 6) : ""));
+	Corpus corpus{"source", {}, 0};
+	while (corpus.m_text.size() < size)
+	{
+		corpus.m_text.append(Random::m_int(0, 4), '\t');
+		const uint64_t count = Random::m_int(2, 12);
+		for (uint64_t i = 0; i < count; i++)
+		{
+			const uint64_t kind = Random::m_int(0, 9);
+			corpus.m_text += kind < 2 ? Random::m_getFrom(keywords) : kind < 5 ? Random::m_getFrom(symbols) : Random::m_getFrom(identifiers);
+			corpus.m_text += ' ';
+		}
+		corpus.m_text += '\n';
+	}
+	return corpus;
+}
+
+// lines of nothing but 'a': every position passes the first/last byte filter of a needle made of 'a'.
+// That's ~50x slower per byte than text, so this corpus is 1/16 the size of the others
+Corpus makeRepeats(size_t size)
+{
+	Corpus corpus{"repeats", {}, 0};
+	while (corpus.m_text.size() < size / 16)
+	{
+		corpus.m_text.append(Random::m_int(60, 200), 'a');
+		corpus.m_text += '\n';
+	}
+	return corpus;
+}
+
+// the needle a corpus is searched for, rare in it unless it's planted
+std::string makeNeedle(const Corpus &corpus, size_t length)
+{
+	if (corpus.m_name != "repeats")
+		return randomWord(length, length);
+	std::string needle(length, 'a'); // first and last byte match everywhere, the middle never does
+	if (length > 2)
+		needle[length / 2] = 'b';
+	return needle;
+}
+
+// writes "needle" over "per_mb" random spots per MB, never across a line end
+std::string plant(const std::string &text, const std::string &needle, uint64_t per_mb)
+{
+	std::string planted = text;
+	const uint64_t count = per_mb * text.size() / (1 << 20);
+	for (uint64_t i = 0, tries = 0; i < count && tries < count * 10; tries++)
+	{
+		const uint64_t at = Random::m_int(0, text.size() - needle.size() - 1);
+		if (std::memchr(planted.data() + at, '\n', needle.size()) != nullptr)
+			continue;
+		planted.replace(at, needle.size(), needle);
+		i++;
+	}
+	return planted;
+}
+
+uint64_t findAll(std::string_view text, std::string_view needle)
+{
+	uint64_t found = 0;
+	const char *end = text.data() + text.size();
+	for (const char *p = funcs::findSequence(text.data(), end, needle); p != nullptr; p = funcs::findSequence(p + 1, end, needle))
+		found++;
+	return found;
+}
+
+uint64_t scanLines(std::string_view text, const Matcher &matcher)
+{
+	uint64_t found = 0;
+	LineSearcher searcher(matcher);
+	searcher.m_searchBlock(text, 0, [&](const ScanHit &) -> bool {
+		found++;
+		return true;
+	});
+	return found;
+}
+
+std::string fixed(double value, int digits)
+{
+	char text[32];
+	std::snprintf(text, sizeof(text), "%.*f", digits, value);
+	return text;
+}
+
+struct Kernel
+{
+	const char *m_name;
+	bool m_nocase;
+	uint64_t (*m_run)(std::string_view text, std::string_view needle, const Matcher &matcher); // returns how many lines/occurrences matched
+};
+
+const Kernel KERNELS[] = {
+	{"find", false, [](std::string_view text, std::string_view needle, const Matcher &) -> uint64_t { return findAll(text, needle); }},
+	{"scan", false, [](std::string_view text, std::string_view, const Matcher &matcher) -> uint64_t { return scanLines(text, matcher); }},
+	{"scan -i", true, [](std::string_view text, std::string_view, const Matcher &matcher) -> uint64_t { return scanLines(text, matcher); }},
+	{"count", false, [](std::string_view text, std::string_view, const Matcher &matcher) -> uint64_t {
+		 return scanner::countBlock(matcher, text, UINT64_MAX, []() -> bool { return false; });
+	 }},
+};
+
+// occurrences for find, matching lines for the others
+uint64_t matchesOf(const Kernel &kernel, std::string_view text, std::string_view needle, const Matcher &matcher)
+{
+	if (std::string_view(kernel.m_name) == "find")
+		return findAll(text, needle);
+	return scanner::countBlock(matcher, text, UINT64_MAX, []() -> bool { return false; });
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+	CLIParser parser(argc, argv);
+	if (parser.m_hasFlag("-h"))
+	{
+		funcs::print("Usage: ", argv[0], " [--size MB] [--samples N] [--time SECONDS] [--corpus text|logs|source|repeats] [--csv FILE] [--counters]\n");
+		return EXIT_SUCCESS;
+	}
+	const size_t size = (parser.m_hasFlag("--size") ? std::stoul(parser.m_getValue("--size")) : 8) << 20;
+	CBenchmarkOptions options;
+	options.m_warmup = 1;
+	options.m_samples = parser.m_hasFlag("--samples") ? std::stoul(parser.m_getValue("--samples")) : 10;
+	options.m_target_time = parser.m_hasFlag("--time") ? std::stod(parser.m_getValue("--time")) : 0.03; // per point
+	const std::string only = parser.m_getValue("--corpus");
+	if (parser.m_hasFlag("--counters"))
+	{
+		const CPerfCounters probe;
+		options.m_perf_counters = probe.m_available();
+		if (!probe.m_available())
+			funcs::print("--counters: ", probe.m_error(), ", timing only\n");
+	}
+
+	Random::m_seed(42); // same corpora every time
+	std::vector<Corpus> corpora;
+	for (Corpus (*make)(size_t) : {makeText, makeLogs, makeSource, makeRepeats})
+	{
+		Corpus corpus = make(size);
+		corpus.m_lines = simd::count(corpus.m_text.data(), corpus.m_text.data() + corpus.m_text.size(), '\n');
+		if (only.empty() || only == corpus.m_name)
+			corpora.push_back(std::move(corpus));
+	}
+
+	funcs::print("SIMD level: ", simd::levelName(simd::currentLevel()), ", corpora of ", size >> 20, " MB (repeats: ", size >> 14, " KB), ", options.m_samples, " samples of ", options.m_target_time, " s per point\n");
+	Table table;
+	if (options.m_perf_counters)
+		table.m_setHeader("corpus", "kernel", "needle", "planted/MB", "matches", "GB/s", "cycles/B", "spread", "Mlines/s", "ns/match", "IPC", "instr/B",
+						  "L1D miss/KB", "LLC miss/KB", "br miss/KB");
+	else
+		table.m_setHeader("corpus", "kernel", "needle", "planted/MB", "matches", "GB/s", "cycles/B", "spread", "Mlines/s", "ns/match");
+
+	const size_t needle_lengths[] = {1, 2, 4, 8, 16, 32, 64};
+	const uint64_t densities[] = {0, 1, 100, 10000};
+	for (const Corpus &corpus : corpora)
+	{
+		for (const size_t length : needle_lengths)
+		{
+			const std::string needle = makeNeedle(corpus, length);
+			const std::unique_ptr<Matcher> exact = makeMatcher({needle}, false);
+			const std::unique_ptr<Matcher> nocase = makeMatcher({needle}, true);
+			std::vector<std::string> texts; // one per density
+			for (const uint64_t density : densities)
+			{
+				if (density * length * 4 > (1 << 20)) // more than a quarter of the text would be needles
+					break;
+				texts.push_back(density == 0 ? corpus.m_text : plant(corpus.m_text, needle, density));
+			}
+
+			for (const Kernel &kernel : KERNELS)
+			{
+				const Matcher &matcher = kernel.m_nocase ? *nocase : *exact;
+				double base_seconds = 0;
+				uint64_t base_matches = 0;
+				for (size_t d = 0; d < texts.size(); d++)
+				{
+					const uint64_t density = densities[d];
+					const std::string &text = texts[d];
+					const uint64_t matches = matchesOf(kernel, text, needle, matcher);
+					const CBenchmarkResult result = CBenchmark::m_measure(options, [&]() { CBenchmark::m_doNotOptimize(kernel.m_run(text, needle, matcher)); });
+					const double seconds = static_cast<double>(result.m_median);
+					if (density == 0)
+					{
+						base_seconds = seconds;
+						base_matches = matches;
+					}
+					const bool extra = matches >= base_matches + 1000 && seconds > base_seconds; // fewer hits than that drown in the noise
+					const std::string gbps = fixed(static_cast<double>(text.size()) / seconds / 1e9, 2);
+					const std::string cycles = fixed(seconds * CycleCounter::m_ticksPerSecond() / static_cast<double>(text.size()), 3);
+					const std::string spread = fixed(static_cast<double>(result.m_mad / result.m_median) * 100, 1) + "%";
+					const std::string mlines = fixed(static_cast<double>(corpus.m_lines) / seconds / 1e6, 1);
+					const std::string per_match = extra ? fixed((seconds - base_seconds) * 1e9 / static_cast<double>(matches - base_matches), 1) : "-";
+					if (options.m_perf_counters)
+					{
+						const CPerfResult &perf = result.m_perf;
+						const double bytes = static_cast<double>(text.size());
+						auto perKB = [&](double count) -> std::string { return perf.m_available && count >= 0 ? fixed(count * 1024 / bytes, 2) : "-"; };
+						table.m_addRow(corpus.m_name, kernel.m_name, length, density, matches, gbps, cycles, spread, mlines, per_match,
+									   perf.m_ipc() >= 0 ? fixed(perf.m_ipc(), 2) : "-", perf.m_instructions >= 0 ? fixed(perf.m_instructions / bytes, 3) : "-",
+									   perKB(perf.m_l1d_misses), perKB(perf.m_llc_misses), perKB(perf.m_branch_misses));
+					}
+					else
+						table.m_addRow(corpus.m_name, kernel.m_name, length, density, matches, gbps, cycles, spread, mlines, per_match);
+				}
+			}
+		}
+	}
+
+	std::cout << table;
+	if (parser.m_hasFlag("--csv"))
+		table.m_exportCSV(parser.m_getValue("--csv"));
+	return EXIT_SUCCESS;
+}
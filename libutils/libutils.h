@@ -1,6 +1,7 @@
 #ifndef LIBUTILS_H
 #define LIBUTILS_H
 
+#include "src/ahocorasick.hpp"
 #include "src/benchmark.hpp"
 #include "src/binarycache.hpp"
 #include "src/cliparser.hpp"
@@ -9,11 +10,17 @@
 #include "src/funcs.hpp"
 #include "src/log.hpp"
 #include "src/pager.hpp"
+#include "src/profiler.hpp"
 #include "src/random.hpp"
+#include "src/regex.hpp"
+#include "src/simd.hpp"
 #include "src/strutils.hpp"
+#include "src/suffixarray.hpp"
 #include "src/table.hpp"
+#include "src/teddy.hpp"
 #include "src/texteditor.hpp"
 #include "src/timer.hpp"
 #include "src/tokenizer.hpp"
+#include "src/utf8.hpp"
 
 #endif //LIBUTILS_H
\ No newline at end of file
@@ -0,0 +1,269 @@
+/* Part of https://github.com/HassanIQ777/libutils
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef AHOCORASICK_HPP
+#define AHOCORASICK_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#include "simd.hpp" // simd::foldAscii
+
+/* EXAMPLE: */
+/*
+AhoCorasick ac;
+ac.m_build({"ERROR", "FATAL", "panic"});
+
+if (ac.m_contains(line))
+	...
+*/
+
+/* Multi-pattern search in one pass, for when funcs::hasSequence would need one pass per pattern.
+ * Memory layout, in BFS order so the shallow (hot) states come first:
+ *   - the first few states (root included) get a full 256 entry transition row with the failure
+ *     links already folded in, so the hot part of the automaton is a plain DFA
+ *   - every other state keeps its children in flat sorted arrays (byte + target) and falls back
+ *     to its failure link when a byte isn't there
+ * Footprint is about 21 bytes per trie state + 1KB per dense state, see m_memoryUsage(). */
+
+class AhoCorasick
+{
+  public:
+	static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+	static constexpr size_t DEFAULT_DENSE_BUDGET = size_t(4) << 20; // bytes for dense rows (4096 states)
+
+	void m_build(const std::vector<std::string> &patterns, bool case_insensitive = false, size_t dense_budget = DEFAULT_DENSE_BUDGET); // empty patterns are ignored
+
+	const char *m_find(const char *begin, const char *end, uint32_t *pattern = nullptr) const; // start of the first match to end in [begin, end), nullptr if none
+	bool m_contains(std::string_view text) const;
+	void m_findAll(std::string_view text, std::vector<uint32_t> &patterns) const; // ids of every pattern in text, sorted, no duplicates
+
+	const std::string &m_pattern(uint32_t id) const { return p_patterns[id]; }
+	size_t m_patternCount() const { return p_patterns.size(); }
+	size_t m_stateCount() const { return p_fail.size(); }
+	size_t m_denseStates() const { return p_dense_states; }
+	size_t m_memoryUsage() const; // bytes used by the automaton (patterns not included)
+
+  private:
+	std::vector<std::string> p_patterns;
+	uint8_t p_fold[256] = {}; // every input byte goes through this, ASCII folding for case insensitive automatons
+	uint32_t p_dense_states = 0;
+	std::vector<uint32_t> p_dense;		 // p_dense_states * 256
+	std::vector<uint32_t> p_edge_offset; // children of state s are [p_edge_offset[s], p_edge_offset[s + 1])
+	std::vector<uint8_t> p_edge_bytes;	 // sorted per state
+	std::vector<uint32_t> p_edge_next;
+	std::vector<uint32_t> p_fail;
+	std::vector<uint32_t> p_output; // pattern ending here (itself or through a failure link), NONE if nothing does
+	std::vector<uint32_t> p_own;	// pattern that ends exactly at this state, NONE if none
+	std::vector<uint32_t> p_dict;	// next state down the failure chain with p_own != NONE
+
+	uint32_t p_child(uint32_t state, uint8_t byte) const
+	{
+		const uint32_t first = p_edge_offset[state];
+		const uint32_t last = p_edge_offset[state + 1];
+		if (last - first <= 8)
+		{
+			for (uint32_t i = first; i < last; i++)
+			{
+				if (p_edge_bytes[i] == byte)
+					return p_edge_next[i];
+			}
+			return NONE;
+		}
+		auto it = std::lower_bound(p_edge_bytes.begin() + first, p_edge_bytes.begin() + last, byte);
+		if (it == p_edge_bytes.begin() + last || *it != byte)
+			return NONE;
+		return p_edge_next[static_cast<size_t>(it - p_edge_bytes.begin())];
+	}
+
+	uint32_t p_next(uint32_t state, uint8_t byte) const
+	{
+		while (state >= p_dense_states) // failure links always go to shallower states, so this ends at a dense one
+		{
+			uint32_t child = p_child(state, byte);
+			if (child != NONE)
+				return child;
+			state = p_fail[state];
+		}
+		return p_dense[static_cast<size_t>(state) * 256 + byte];
+	}
+};
+
+void AhoCorasick::m_build(const std::vector<std::string> &patterns, bool case_insensitive, size_t dense_budget)
+{
+	for (unsigned byte = 0; byte < 256; byte++)
+	{
+		const char c = static_cast<char>(byte);
+		p_fold[byte] = static_cast<uint8_t>(case_insensitive ? simd::foldAscii(c) : c);
+	}
+
+	p_patterns.clear();
+	for (const auto &pattern : patterns)
+	{
+		if (!pattern.empty())
+			p_patterns.push_back(case_insensitive ? simd::foldAscii(pattern) : pattern);
+	}
+	std::sort(p_patterns.begin(), p_patterns.end());
+	p_patterns.erase(std::unique(p_patterns.begin(), p_patterns.end()), p_patterns.end());
+
+	// 1. trie, children come out sorted by byte because the patterns are sorted
+	struct Node
+	{
+		std::vector<std::pair<uint8_t, uint32_t>> m_children;
+		uint32_t m_pattern = NONE;
+	};
+	std::vector<Node> trie(1);
+	for (uint32_t id = 0; id < p_patterns.size(); id++)
+	{
+		uint32_t state = 0;
+		for (unsigned char byte : p_patterns[id])
+		{
+			auto &children = trie[state].m_children;
+			if (!children.empty() && children.back().first == byte)
+			{
+				state = children.back().second;
+				continue;
+			}
+			children.push_back({byte, static_cast<uint32_t>(trie.size())});
+			state = static_cast<uint32_t>(trie.size());
+			trie.emplace_back();
+		}
+		trie[state].m_pattern = id;
+	}
+
+	// 2. renumber in BFS order and flatten the children
+	const size_t state_count = trie.size();
+	std::vector<uint32_t> order; // BFS index -> trie node
+	std::vector<uint32_t> bfs_index(state_count);
+	order.reserve(state_count);
+	order.push_back(0);
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		for (const auto &[byte, child] : trie[order[i]].m_children)
+			order.push_back(child);
+	}
+	for (uint32_t i = 0; i < state_count; i++)
+		bfs_index[order[i]] = i;
+
+	p_edge_offset.assign(state_count + 1, 0);
+	p_edge_bytes.clear();
+	p_edge_next.clear();
+	p_own.assign(state_count, NONE);
+	for (uint32_t s = 0; s < state_count; s++)
+	{
+		const Node &node = trie[order[s]];
+		p_edge_offset[s] = static_cast<uint32_t>(p_edge_bytes.size());
+		for (const auto &[byte, child] : node.m_children)
+		{
+			p_edge_bytes.push_back(byte);
+			p_edge_next.push_back(bfs_index[child]);
+		}
+		p_own[s] = node.m_pattern;
+	}
+	p_edge_offset[state_count] = static_cast<uint32_t>(p_edge_bytes.size());
+	trie.clear();
+	trie.shrink_to_fit();
+
+	// 3. failure links and outputs, parents are always before their children in BFS order
+	p_fail.assign(state_count, 0);
+	p_output.assign(state_count, NONE);
+	p_dict.assign(state_count, NONE);
+	p_dense_states = 0; // p_next() has to walk the sparse arrays while building
+	for (uint32_t s = 0; s < state_count; s++)
+	{
+		if (s != 0)
+		{
+			p_output[s] = p_own[s] != NONE ? p_own[s] : p_output[p_fail[s]];
+			p_dict[s] = p_own[p_fail[s]] != NONE ? p_fail[s] : p_dict[p_fail[s]];
+		}
+		for (uint32_t e = p_edge_offset[s]; e < p_edge_offset[s + 1]; e++)
+		{
+			const uint32_t child = p_edge_next[e];
+			if (s == 0)
+			{
+				p_fail[child] = 0;
+				continue;
+			}
+			uint32_t state = p_fail[s];
+			uint32_t target = p_child(state, p_edge_bytes[e]);
+			while (target == NONE && state != 0)
+			{
+				state = p_fail[state];
+				target = p_child(state, p_edge_bytes[e]);
+			}
+			p_fail[child] = target == NONE ? 0 : target;
+		}
+	}
+
+	// 4. dense rows for the hot states, a missing byte takes the (already built) row of the failure state
+	const uint32_t dense_states = static_cast<uint32_t>(std::clamp<size_t>(dense_budget / (256 * sizeof(uint32_t)), 1, state_count));
+	p_dense.assign(static_cast<size_t>(dense_states) * 256, 0);
+	for (uint32_t s = 0; s < dense_states; s++)
+	{
+		uint32_t *row = &p_dense[static_cast<size_t>(s) * 256];
+		if (s != 0)
+			std::copy_n(&p_dense[static_cast<size_t>(p_fail[s]) * 256], 256, row);
+		for (uint32_t e = p_edge_offset[s]; e < p_edge_offset[s + 1]; e++)
+			row[p_edge_bytes[e]] = p_edge_next[e];
+	}
+	p_dense_states = dense_states;
+}
+
+const char *AhoCorasick::m_find(const char *begin, const char *end, uint32_t *pattern) const
+{
+	if (p_patterns.empty())
+		return nullptr;
+
+	uint32_t state = 0;
+	for (const char *p = begin; p < end; ++p)
+	{
+		state = p_next(state, p_fold[static_cast<uint8_t>(*p)]);
+		const uint32_t id = p_output[state];
+		if (id != NONE)
+		{
+			if (pattern != nullptr)
+				*pattern = id;
+			return p + 1 - p_patterns[id].size();
+		}
+	}
+	return nullptr;
+}
+
+bool AhoCorasick::m_contains(std::string_view text) const
+{
+	return m_find(text.data(), text.data() + text.size()) != nullptr;
+}
+
+void AhoCorasick::m_findAll(std::string_view text, std::vector<uint32_t> &patterns) const
+{
+	patterns.clear();
+	if (p_patterns.empty())
+		return;
+
+	uint32_t state = 0;
+	for (unsigned char byte : text)
+	{
+		state = p_next(state, p_fold[byte]);
+		for (uint32_t s = (p_own[state] != NONE) ? state : p_dict[state]; s != NONE; s = p_dict[s])
+			patterns.push_back(p_own[s]);
+	}
+	std::sort(patterns.begin(), patterns.end());
+	patterns.erase(std::unique(patterns.begin(), patterns.end()), patterns.end());
+}
+
+size_t AhoCorasick::m_memoryUsage() const
+{
+	return p_dense.capacity() * sizeof(uint32_t) +
+		   p_edge_offset.capacity() * sizeof(uint32_t) +
+		   p_edge_bytes.capacity() * sizeof(uint8_t) +
+		   p_edge_next.capacity() * sizeof(uint32_t) +
+		   (p_fail.capacity() + p_output.capacity() + p_own.capacity() + p_dict.capacity()) * sizeof(uint32_t);
+}
+
+#endif // ahocorasick.hpp
@@ -1,22 +1,265 @@
 /* Part of https://github.com/HassanIQ777/libutils
 Made on: 	2025-Jul-20
-Last update: 2025-Sep-06 */
+Last update: 2026-Oct-17 */
 
 #ifndef BENCHMARK_HPP
 #define BENCHMARK_HPP
 
 #include <cstdint>
+#include <cstddef>
+#include <cmath>
 #include <chrono>
 #include <functional>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <type_traits>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <memory>
 
 #if defined(__x86_64__) || defined(__i386__)
 #include <x86intrin.h>
 #endif
 
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* EXAMPLE: */
+/*
+CBenchmarkOptions options;
+options.m_target_time = 1.0; // seconds of measuring, split over 30 samples
+CBenchmarkResult result = CBenchmark::m_measure(options, [&]() {
+	CBenchmark::m_doNotOptimize(funcs::findSequence(begin, end, needle));
+});
+print(result.m_median * 1e9, " ns +- ", result.m_mad * 1e9, " (p99 ", result.m_p99 * 1e9, ")\n");
+
+options.m_perf_counters = true; // Linux hardware counters around every sample, if the kernel lets us
+result = CBenchmark::m_measure(options, [&]() { CBenchmark::m_doNotOptimize(funcs::findSequence(begin, end, needle)); });
+if (result.m_perf.m_available)
+	print("IPC ", result.m_perf.m_ipc(), ", ", result.m_perf.m_branch_misses / (end - begin), " branch misses per byte\n");
+else
+	print("no counters: ", result.m_perf.m_error, "\n");
+
+CycleCounter counter;
+counter.m_start();
+scanChunk(chunk);
+counter.m_stop();
+print(counter.m_cycles(), " ticks, ", counter.m_nanoseconds(), " ns\n");
+*/
+
+// ======================
+// CPerfCounters
+// ======================
+
+/* Linux perf_event_open counters of the calling thread (user space only), opened as one group so they all
+ * count over exactly the same stretch. A counter the CPU doesn't have is left out (-1), the others still count.
+ * None of it works when kernel.perf_event_paranoid is 3 or more (Debian's default), without a PMU
+ * (most VMs/containers) or off Linux: m_available() is false then and m_error() says why.
+ * When the PMU has to be shared (more groups than counters), the counts are scaled up from the time the group ran. */
+
+struct CPerfResult
+{
+	bool m_available = false; // false when no counter could be opened, m_error says why
+	std::string m_error;
+	// per call, -1 for a counter this CPU doesn't have
+	double m_cycles = -1;		 // core cycles (not TSC ticks, they change with the clock)
+	double m_instructions = -1;
+	double m_l1d_misses = -1;	 // L1 data cache read misses
+	double m_llc_misses = -1;	 // last level cache misses
+	double m_branch_misses = -1;
+
+	double m_ipc() const { return m_cycles > 0 && m_instructions >= 0 ? m_instructions / m_cycles : -1; }
+};
+
+class CPerfCounters
+{
+  public:
+	static constexpr size_t COUNTERS = 5; // in CPerfResult's order
+
+	CPerfCounters();
+	~CPerfCounters();
+	CPerfCounters(const CPerfCounters &) = delete;
+	CPerfCounters &operator=(const CPerfCounters &) = delete;
+
+	bool m_available() const { return p_leader >= 0; }
+	const std::string &m_error() const { return p_error; }
+
+	void m_start(); // reset and start counting
+	void m_stop();	// stop, and add what was counted since m_start to the totals
+	CPerfResult m_result(uint64_t calls) const; // the totals divided by "calls"
+
+  private:
+	int p_fds[COUNTERS] = {-1, -1, -1, -1, -1};
+	uint64_t p_ids[COUNTERS] = {};
+	double p_totals[COUNTERS] = {};
+	int p_leader = -1;
+	bool p_scheduled = true; // false once the group didn't get to count at all
+	std::string p_error;
+};
+
+#if defined(__linux__)
+inline CPerfCounters::CPerfCounters()
+{
+	const uint64_t cache_read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	const std::pair<uint32_t, uint64_t> events[COUNTERS] = {
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+		{PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cache_read_miss},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	};
+
+	int first_errno = 0;
+	for (size_t i = 0; i < COUNTERS; i++)
+	{
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = events[i].first;
+		attr.config = events[i].second;
+		attr.disabled = p_leader < 0; // the leader starts and stops the whole group
+		attr.exclude_kernel = 1;	  // what paranoid level 2 still allows
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		const int fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, p_leader, PERF_FLAG_FD_CLOEXEC));
+		if (fd < 0)
+		{
+			if (first_errno == 0)
+				first_errno = errno;
+			continue;
+		}
+		p_fds[i] = fd;
+		::ioctl(fd, PERF_EVENT_IOC_ID, &p_ids[i]);
+		if (p_leader < 0)
+			p_leader = fd;
+	}
+	if (p_leader >= 0)
+		return;
+
+	if (first_errno == EACCES || first_errno == EPERM)
+	{
+		int paranoid = -1;
+		std::ifstream("/proc/sys/kernel/perf_event_paranoid") >> paranoid;
+		p_error = "not allowed, kernel.perf_event_paranoid is " + std::to_string(paranoid) + " (it has to be 2 or less, or run with CAP_PERFMON)";
+	}
+	else if (first_errno == ENOENT || first_errno == ENODEV || first_errno == EOPNOTSUPP)
+		p_error = "no hardware counters here (a VM without a virtual PMU?)";
+	else if (first_errno == ENOSYS)
+		p_error = "the kernel was built without perf events";
+	else
+		p_error = std::string("perf_event_open failed: ") + std::strerror(first_errno);
+}
+
+inline CPerfCounters::~CPerfCounters()
+{
+	for (int fd : p_fds)
+	{
+		if (fd >= 0)
+			::close(fd);
+	}
+}
+
+inline void CPerfCounters::m_start()
+{
+	if (p_leader < 0)
+		return;
+	::ioctl(p_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	::ioctl(p_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+inline void CPerfCounters::m_stop()
+{
+	if (p_leader < 0)
+		return;
+	::ioctl(p_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+	// nr, time_enabled, time_running, then {value, id} per counter
+	uint64_t data[3 + 2 * COUNTERS];
+	const ssize_t length = ::read(p_leader, data, sizeof(data));
+	if (length < static_cast<ssize_t>(3 * sizeof(uint64_t)))
+		return;
+	const uint64_t enabled = data[1], running = data[2];
+	if (running == 0)
+	{
+		p_scheduled = false;
+		return;
+	}
+	const double scale = static_cast<double>(enabled) / static_cast<double>(running);
+	for (uint64_t n = 0; n < data[0] && n < COUNTERS; n++)
+	{
+		for (size_t i = 0; i < COUNTERS; i++)
+		{
+			if (p_fds[i] >= 0 && p_ids[i] == data[4 + 2 * n])
+				p_totals[i] += static_cast<double>(data[3 + 2 * n]) * scale;
+		}
+	}
+}
+#else
+inline CPerfCounters::CPerfCounters() : p_error("hardware counters are only read on Linux") {}
+inline CPerfCounters::~CPerfCounters() {}
+inline void CPerfCounters::m_start() {}
+inline void CPerfCounters::m_stop() {}
+#endif
+
+inline CPerfResult CPerfCounters::m_result(uint64_t calls) const
+{
+	CPerfResult result;
+	result.m_available = p_leader >= 0 && p_scheduled && calls > 0;
+	result.m_error = p_leader >= 0 && !p_scheduled ? "the counters never got scheduled (all of the PMU is in use, e.g. by the NMI watchdog)" : p_error;
+	if (!result.m_available)
+		return result;
+	double *values[COUNTERS] = {&result.m_cycles, &result.m_instructions, &result.m_l1d_misses, &result.m_llc_misses, &result.m_branch_misses};
+	for (size_t i = 0; i < COUNTERS; i++)
+	{
+		if (p_fds[i] >= 0)
+			*values[i] = p_totals[i] / static_cast<double>(calls);
+	}
+	return result;
+}
+
+// ======================
+// CBenchmark
+// ======================
+
+/* m_run times "runs" calls one by one, m_measure is for numbers that have to hold up when comparing:
+ * a warmup, then the iterations per sample are doubled until one sample takes target_time / samples
+ * (so clock overhead and timer resolution don't matter), then the samples are taken.
+ * Noise (interrupts, other processes, frequency changes) only ever makes a sample slower, so samples more than
+ * outlier_mads scaled MADs above the median are left out of the mean and stddev. The median, percentiles and MAD
+ * are over every sample and don't need that. */
+
 struct CBenchmarkResult
 {
-	long double m_average; // seconds
-	long double m_total;
+	long double m_average = 0.0L; // seconds per call (mean of the samples that weren't outliers)
+	long double m_total = 0.0L;	  // seconds spent in the timed calls
+	long double m_median = 0.0L;
+	long double m_p90 = 0.0L;
+	long double m_p99 = 0.0L;
+	long double m_min = 0.0L;
+	long double m_max = 0.0L;
+	long double m_stddev = 0.0L; // of the samples that weren't outliers
+	long double m_mad = 0.0L;	 // median absolute deviation from the median
+	size_t m_iterations = 0;	 // calls per sample
+	size_t m_outliers = 0;		 // samples left out of the mean/stddev
+	std::vector<long double> m_samples; // seconds per call of every sample, in the order they were taken
+	CPerfResult m_perf;					// hardware counters per call, with CBenchmarkOptions::m_perf_counters
+};
+
+struct CBenchmarkOptions
+{
+	size_t m_warmup = 3;		   // untimed calls first (caches, page faults, branch predictors, CPU clocking up)
+	size_t m_samples = 30;		   // timed samples
+	double m_target_time = 0.5;	   // seconds all samples together should take, sets the calls per sample
+	size_t m_iterations = 0;	   // calls per sample, 0 = calibrate to target_time
+	double m_outlier_mads = 5.0;   // a sample this many scaled MADs above the median is an outlier, 0 keeps every sample
+	bool m_perf_counters = false;  // count cycles, instructions, cache and branch misses over the samples (CPerfCounters)
 };
 
 class CBenchmark
@@ -24,31 +267,198 @@ class CBenchmark
   public:
 	template <typename Func, typename... Args>
 	static CBenchmarkResult m_run(const size_t &runs, Func &&func, Args &&... args);
+
+	template <typename Func, typename... Args>
+	static CBenchmarkResult m_measure(const CBenchmarkOptions &options, Func &&func, Args &&... args);
+
+	// the compiler has to assume "value" is read (and for a non-const one, changed), so the code computing it stays
+	template <typename T>
+	static void m_doNotOptimize(const T &value);
+	template <typename T>
+	static void m_doNotOptimize(T &value);
+	// every write before this has to actually happen (e.g. to a buffer nothing reads afterwards)
+	static void m_clobberMemory();
+
+	static CBenchmarkResult m_statistics(std::vector<long double> samples, double outlier_mads = 5.0); // samples in seconds per call
+
+  private:
+	template <typename Func, typename... Args>
+	static long double p_time(size_t iterations, Func &func, Args &... args);
 };
 // end of class
 
+template <typename T>
+inline void CBenchmark::m_doNotOptimize(const T &value)
+{
+#if defined(__GNUC__)
+	if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(void *))
+		asm volatile("" : : "r,m"(value) : "memory");
+	else
+		asm volatile("" : : "m"(value) : "memory");
+#else
+	static volatile const T *sink;
+	sink = &value;
+#endif
+}
+
+template <typename T>
+inline void CBenchmark::m_doNotOptimize(T &value)
+{
+#if defined(__GNUC__)
+	if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(void *))
+		asm volatile("" : "+m,r"(value) : : "memory"); // gcc rejects "+r,m"
+	else
+		asm volatile("" : "+m"(value) : : "memory");
+#else
+	static volatile T *sink;
+	sink = &value;
+#endif
+}
+
+inline void CBenchmark::m_clobberMemory()
+{
+#if defined(__GNUC__)
+	asm volatile("" : : : "memory");
+#else
+	std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+template <typename Func, typename... Args>
+long double CBenchmark::p_time(size_t iterations, Func &func, Args &... args)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; ++i)
+		std::invoke(func, args...);
+	const auto end = std::chrono::steady_clock::now();
+	return static_cast<long double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / 1'000'000'000.0L;
+}
+
+inline CBenchmarkResult CBenchmark::m_statistics(std::vector<long double> samples, double outlier_mads)
+{
+	CBenchmarkResult result;
+	if (samples.empty())
+		return result;
+	result.m_samples = samples;
+
+	std::sort(samples.begin(), samples.end());
+	auto percentile = [&](const std::vector<long double> &sorted, double p) -> long double { // linear between the closest ranks
+		const long double rank = static_cast<long double>(p) * static_cast<long double>(sorted.size() - 1);
+		const size_t low = static_cast<size_t>(rank);
+		const size_t high = std::min(low + 1, sorted.size() - 1);
+		return sorted[low] + (sorted[high] - sorted[low]) * (rank - static_cast<long double>(low));
+	};
+	result.m_min = samples.front();
+	result.m_max = samples.back();
+	result.m_median = percentile(samples, 0.5);
+	result.m_p90 = percentile(samples, 0.9);
+	result.m_p99 = percentile(samples, 0.99);
+
+	std::vector<long double> deviations;
+	for (long double sample : samples)
+		deviations.push_back(std::fabs(sample - result.m_median));
+	std::sort(deviations.begin(), deviations.end());
+	result.m_mad = percentile(deviations, 0.5);
+
+	// 1.4826 * MAD estimates the stddev of normally distributed samples, without being dragged up by the outliers.
+	// When more than half the samples are identical the MAD is 0, the mean absolute deviation stands in then
+	long double scale = 1.4826L * result.m_mad;
+	if (scale == 0.0L)
+	{
+		for (long double deviation : deviations)
+			scale += deviation;
+		scale = 1.2533L * scale / static_cast<long double>(deviations.size());
+	}
+	const long double limit = result.m_median + static_cast<long double>(outlier_mads) * scale;
+	long double sum = 0.0L;
+	size_t kept = 0;
+	for (long double sample : samples)
+	{
+		if (outlier_mads > 0.0 && sample > limit)
+			continue;
+		sum += sample;
+		kept++;
+	}
+	result.m_outliers = samples.size() - kept;
+	result.m_average = sum / static_cast<long double>(kept);
+
+	long double squares = 0.0L;
+	for (size_t i = 0; i < kept; i++) // the kept ones are the smallest, samples is sorted
+		squares += (samples[i] - result.m_average) * (samples[i] - result.m_average);
+	result.m_stddev = kept > 1 ? std::sqrt(squares / static_cast<long double>(kept - 1)) : 0.0L;
+	return result;
+}
+
 template <typename Func, typename... Args>
 CBenchmarkResult CBenchmark::m_run(const size_t &runs, Func &&func, Args &&... args)
 {
 	if (runs == 0)
-		return {0.0L, 0.0L};
-
-	auto start = std::chrono::high_resolution_clock::now();
+		return {};
 
+	std::vector<long double> samples;
+	samples.reserve(runs);
 	for (size_t i = 0; i < runs; ++i)
+		samples.push_back(p_time(1, func, args...));
+
+	CBenchmarkResult result = m_statistics(samples, 0.0);
+	result.m_iterations = 1;
+	for (long double sample : samples)
+		result.m_total += sample;
+	return result;
+}
+
+template <typename Func, typename... Args>
+CBenchmarkResult CBenchmark::m_measure(const CBenchmarkOptions &options, Func &&func, Args &&... args)
+{
+	if (options.m_samples == 0)
+		return {};
+
+	for (size_t i = 0; i < options.m_warmup; ++i)
+		std::invoke(func, args...);
+
+	size_t iterations = options.m_iterations;
+	if (iterations == 0)
 	{
-		std::invoke(std::forward<Func>(func), std::forward<Args>(args)...);
+		const long double sample_time = static_cast<long double>(options.m_target_time) / static_cast<long double>(options.m_samples);
+		iterations = 1;
+		while (p_time(iterations, func, args...) < sample_time && iterations < (size_t(1) << 40))
+			iterations *= 2;
 	}
 
-	auto end = std::chrono::high_resolution_clock::now();
-	auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
-	return {(static_cast<long double>(duration) / runs) / 1'000'000'000.0L,
-			static_cast<long double>(duration) / 1'000'000'000.0L};
+	std::unique_ptr<CPerfCounters> counters;
+	if (options.m_perf_counters)
+		counters = std::make_unique<CPerfCounters>();
+
+	std::vector<long double> samples;
+	samples.reserve(options.m_samples);
+	for (size_t i = 0; i < options.m_samples; ++i)
+	{
+		if (counters != nullptr)
+			counters->m_start(); // the ioctls are outside what p_time times
+		samples.push_back(p_time(iterations, func, args...) / static_cast<long double>(iterations));
+		if (counters != nullptr)
+			counters->m_stop();
+	}
+
+	CBenchmarkResult result = m_statistics(samples, options.m_outlier_mads);
+	result.m_iterations = iterations;
+	if (counters != nullptr)
+		result.m_perf = counters->m_result(static_cast<uint64_t>(iterations) * options.m_samples);
+	for (long double sample : samples)
+		result.m_total += sample * static_cast<long double>(iterations);
+	return result;
 }
 
 // ======================
 // CycleCounter
 // ======================
+
+/* On x86 this counts TSC ticks: a constant rate on every CPU of the last 15 years (invariant TSC),
+ * not the core clock, so it converts to time with one ratio. That ratio is measured once, the first time
+ * it's needed, against steady_clock (~20ms of spinning).
+ * m_start() is lfence; rdtsc; lfence (earlier work has finished, later work hasn't started),
+ * m_stop() is rdtscp; lfence. What two back-to-back reads cost is measured at the same time and taken off m_cycles().
+ * m_read() is a bare rdtsc for instrumenting hot code, ordering is then up to the caller. */
 class CycleCounter
 {
   public:
@@ -57,70 +467,132 @@ class CycleCounter
 	// Start measuring
 	void m_start()
 	{
-		begin = p_read_cycles();
+		p_begin = m_readStart();
 	}
 
 	// Stop measuring
 	void m_stop()
 	{
-		end = p_read_cycles();
+		p_end = m_readStop();
 	}
 
-	// Get elapsed cycles
+	// Get elapsed cycles (TSC ticks on x86), without the cost of the two reads
 	cycles_t m_cycles() const
 	{
-		return end - begin;
+		const cycles_t elapsed = p_end - p_begin;
+		return elapsed > m_overhead() ? elapsed - m_overhead() : 0;
 	}
 
-	// Get elapsed nanoseconds (approx, uses CPU freq if available)
+	// Get elapsed nanoseconds
 	uint64_t m_nanoseconds() const
 	{
-#if defined(__aarch64__)
-		uint64_t freq = p_read_cntfrq();
-		return (m_cycles() * 1'000'000'000ULL) / freq;
+		return m_toNanoseconds(m_cycles());
+	}
+
+	static cycles_t m_read() // cheapest read, no fencing
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#elif defined(__aarch64__)
+		uint64_t count;
+		asm volatile("mrs %0, cntvct_el0" : "=r"(count));
+		return count;
 #else
-		// fallback: assume 1 cycle ~ 1ns (rough!)
-		return m_cycles();
+		return p_steadyNanoseconds();
 #endif
 	}
 
-  private:
-	cycles_t begin = 0, end = 0;
+	static cycles_t m_readStart() // nothing before it is still running, nothing after it has started
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		_mm_lfence();
+		const cycles_t count = __rdtsc();
+		_mm_lfence();
+		return count;
+#elif defined(__aarch64__)
+		asm volatile("isb" ::: "memory");
+		const cycles_t count = m_read();
+		asm volatile("isb" ::: "memory");
+		return count;
+#else
+		return m_read();
+#endif
+	}
 
-	// -------- Platform-specific implementations --------
-	static cycles_t p_read_cycles()
+	static cycles_t m_readStop() // everything before it has finished
 	{
 #if defined(__x86_64__) || defined(__i386__)
 		unsigned int aux;
-		uint64_t r1, r2;
-		asm volatile("cpuid\n\t" ::
-						 : "rax", "rbx", "rcx", "rdx"); // serialize
-		r1 = __rdtsc();
-		asm volatile("cpuid\n\t" ::
-						 : "rax", "rbx", "rcx", "rdx");
-		r2 = __rdtscp(&aux);
-		return r2; // safe value
-#elif defined(__aarch64__)
-		uint64_t cnt;
-		asm volatile("mrs %0, cntvct_el0"
-					 : "=r"(cnt));
-		return cnt;
+		const cycles_t count = __rdtscp(&aux);
+		_mm_lfence();
+		return count;
 #else
-		// fallback: chrono
-		auto now = std::chrono::high_resolution_clock::now().time_since_epoch();
-		return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+		return m_readStart();
 #endif
 	}
 
-#if defined(__aarch64__)
-	static uint64_t p_read_cntfrq()
+	static cycles_t m_overhead() { return p_calibration().m_overhead; } // ticks a m_readStart/m_readStop pair measures with nothing between them
+	static double m_ticksPerSecond() { return p_calibration().m_ticks_per_second; }
+
+	static uint64_t m_toNanoseconds(cycles_t ticks)
 	{
-		uint64_t frq;
-		asm volatile("mrs %0, cntfrq_el0"
-					 : "=r"(frq));
-		return frq;
+		return static_cast<uint64_t>(static_cast<double>(ticks) * 1e9 / m_ticksPerSecond());
 	}
+
+  private:
+	cycles_t p_begin = 0, p_end = 0;
+
+	struct Calibration
+	{
+		double m_ticks_per_second;
+		cycles_t m_overhead;
+	};
+
+	static cycles_t p_steadyNanoseconds()
+	{
+		return static_cast<cycles_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	static const Calibration &p_calibration()
+	{
+		static const Calibration calibration = p_calibrate();
+		return calibration;
+	}
+
+	static Calibration p_calibrate()
+	{
+		Calibration calibration{1e9, 0};
+#if defined(__aarch64__)
+		uint64_t frequency;
+		asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+		calibration.m_ticks_per_second = static_cast<double>(frequency);
+#elif defined(__x86_64__) || defined(__i386__)
+		// median of 5 rounds of ~4ms, a round the thread got preempted in doesn't skew it
+		double rates[5];
+		for (double &rate : rates)
+		{
+			const auto clock_start = std::chrono::steady_clock::now();
+			const cycles_t tick_start = m_readStart();
+			auto clock_end = clock_start;
+			while (clock_end - clock_start < std::chrono::milliseconds(4))
+				clock_end = std::chrono::steady_clock::now();
+			const cycles_t tick_end = m_readStop();
+			rate = static_cast<double>(tick_end - tick_start) / std::chrono::duration<double>(clock_end - clock_start).count();
+		}
+		std::sort(std::begin(rates), std::end(rates));
+		calibration.m_ticks_per_second = rates[2];
 #endif
+		// the smallest of many back-to-back pairs is the cost of the reads themselves
+		cycles_t overhead = ~cycles_t(0);
+		for (int i = 0; i < 1000; i++)
+		{
+			const cycles_t begin = m_readStart();
+			const cycles_t end = m_readStop();
+			overhead = std::min(overhead, end - begin);
+		}
+		calibration.m_overhead = overhead;
+		return calibration;
+	}
 };
 
 #endif // benchmark.hpp
\ No newline at end of file
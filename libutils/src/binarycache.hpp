@@ -1,6 +1,6 @@
 /* Part of https://github.com/HassanIQ777/libutils
 Made on: 	2025-Sep-29
-Last update: 2025-Nov-06 */
+Last update: 2026-Oct-17 */
 
 #ifndef BINARYCACHE_HPP
 #define BINARYCACHE_HPP 
@@ -8,8 +8,18 @@ Last update: 2025-Nov-06 */
 #include <fstream>
 #include <string>
 #include <vector>
+#include <span>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
 #include <type_traits>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 class BinaryCache
 {
   public:
@@ -84,6 +94,141 @@ class BinaryCache
 			in.read(&vec[i][0], static_cast<long>(len));
 		}
 	}
+
+	/* --- Several arrays in one file, mapped back in without copying or parsing ---
+	 * Layout: "BCACHE01", section count, (offset, size) of every section, then the sections,
+	 * each one 8 byte aligned so a mapped section can be used as a T array directly.
+	 * The file is written next to the target and renamed over it, so a reader never sees half a file. */
+	class SectionWriter
+	{
+	  public:
+		template <typename T>
+		void add(const std::vector<T> &data) // data isn't copied, it has to stay alive until save()
+		{
+			static_assert(std::is_trivially_copyable<T>::value,
+						  "BinaryCache::SectionWriter only works with trivially copyable types!");
+			p_sections.push_back({reinterpret_cast<const char *>(data.data()), data.size() * sizeof(T)});
+		}
+
+		void save(const std::string &filename) const
+		{
+			const std::string temporary = filename + ".tmp";
+			std::ofstream out(temporary, std::ios::binary);
+			if (!out)
+				throw std::runtime_error("Failed to open file for writing: " + temporary);
+
+			const uint64_t count = p_sections.size();
+			std::vector<uint64_t> table;
+			uint64_t offset = align(MAGIC_SIZE + sizeof(count) + count * 2 * sizeof(uint64_t));
+			for (const auto &[data, size] : p_sections)
+			{
+				table.push_back(offset);
+				table.push_back(size);
+				offset = align(offset + size);
+			}
+
+			out.write(MAGIC, MAGIC_SIZE);
+			out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+			out.write(reinterpret_cast<const char *>(table.data()), static_cast<long>(table.size() * sizeof(uint64_t)));
+			for (size_t i = 0; i < p_sections.size(); i++)
+			{
+				pad(out, table[i * 2]);
+				out.write(p_sections[i].first, static_cast<long>(p_sections[i].second));
+			}
+			out.close();
+			if (!out || std::rename(temporary.c_str(), filename.c_str()) != 0)
+			{
+				std::remove(temporary.c_str());
+				throw std::runtime_error("Failed to write file: " + filename);
+			}
+		}
+
+	  private:
+		std::vector<std::pair<const char *, size_t>> p_sections;
+
+		static void pad(std::ofstream &out, uint64_t offset)
+		{
+			static const char zeros[8] = {};
+			const uint64_t at = static_cast<uint64_t>(out.tellp());
+			out.write(zeros, static_cast<long>(offset - at));
+		}
+	};
+
+	class MappedSections
+	{
+	  public:
+		explicit MappedSections(const std::string &filename)
+		{
+			const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0)
+				throw std::runtime_error("Failed to open file for reading: " + filename);
+			struct stat st;
+			if (::fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < MAGIC_SIZE + sizeof(uint64_t))
+			{
+				::close(fd);
+				throw std::runtime_error("Not a section file: " + filename);
+			}
+			p_size = static_cast<size_t>(st.st_size);
+			void *addr = ::mmap(nullptr, p_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			::close(fd); // the mapping stays valid, even if the file gets replaced afterwards
+			if (addr == MAP_FAILED)
+				throw std::runtime_error("Failed to map file: " + filename);
+			p_data = static_cast<const char *>(addr);
+
+			uint64_t count;
+			std::memcpy(&count, p_data + MAGIC_SIZE, sizeof(count));
+			if (std::memcmp(p_data, MAGIC, MAGIC_SIZE) != 0 || count > (p_size - MAGIC_SIZE - sizeof(count)) / (2 * sizeof(uint64_t)))
+			{
+				unmap();
+				throw std::runtime_error("Not a section file: " + filename);
+			}
+			p_count = static_cast<size_t>(count);
+			p_table = reinterpret_cast<const uint64_t *>(p_data + MAGIC_SIZE + sizeof(count));
+			for (size_t i = 0; i < p_count; i++)
+			{
+				if (p_table[i * 2] > p_size || p_table[i * 2 + 1] > p_size - p_table[i * 2])
+				{
+					unmap();
+					throw std::runtime_error("Corrupt section file: " + filename);
+				}
+			}
+		}
+		~MappedSections() { unmap(); }
+
+		MappedSections(const MappedSections &) = delete;
+		MappedSections &operator=(const MappedSections &) = delete;
+
+		size_t size() const { return p_count; } // number of sections
+
+		template <typename T>
+		std::span<const T> get(size_t index) const
+		{
+			static_assert(std::is_trivially_copyable<T>::value,
+						  "BinaryCache::MappedSections only works with trivially copyable types!");
+			if (index >= p_count || p_table[index * 2 + 1] % sizeof(T) != 0)
+				throw std::runtime_error("Bad section " + std::to_string(index));
+			return {reinterpret_cast<const T *>(p_data + p_table[index * 2]), p_table[index * 2 + 1] / sizeof(T)};
+		}
+
+	  private:
+		const char *p_data = nullptr;
+		size_t p_size = 0;
+		size_t p_count = 0;
+		const uint64_t *p_table = nullptr;
+
+		void unmap()
+		{
+			if (p_data != nullptr)
+				::munmap(const_cast<char *>(p_data), p_size);
+			p_data = nullptr;
+		}
+	};
+
+  private:
+	static constexpr const char *MAGIC = "BCACHE01";
+	static constexpr size_t MAGIC_SIZE = 8;
+
+	static uint64_t align(uint64_t offset) { return (offset + 7) & ~uint64_t(7); }
 };
 
 #endif // binarycache.hpp
\ No newline at end of file
@@ -1,11 +1,14 @@
 /* Part of https://github.com/HassanIQ777/libutils
-Made on 2024 Dec 2 */
+Made on 2024 Dec 2
+Last update: 2026 Oct 17 */
 
 #ifndef COLOR_HPP
 #define COLOR_HPP
 
 #include <string>
 #include <iostream>
+#include <cstdlib>
+#include <unistd.h>
 
 namespace color
 {
@@ -55,6 +58,21 @@ std::string style(const std::string &modifier, const std::string &text_color, co
 {
 	return modifier + text_color + background_color;
 } // example: std:: cout << color::style(color::modifier::BOLD,color::text::YELLOW,color::background::WHITE) << "Hello World!"<<color::modifier::RESET << std::endl;
+void disable() // every code above becomes "", for output that isn't going to a terminal
+{
+	for (const char **code : {&_RESET, &_BOLD, &_ITALIC, &_UNDER_LINE, &_STRIKE_THROUGH,
+							  &TXT_BLACK, &TXT_RED, &TXT_GREEN, &TXT_YELLOW, &TXT_BLUE, &TXT_MAGENTA, &TXT_CYAN, &TXT_WHITE,
+							  &BG_BLACK, &BG_RED, &BG_GREEN, &BG_YELLOW, &BG_BLUE, &BG_MAGENTA, &BG_CYAN, &BG_WHITE})
+		*code = "";
+}
+
+bool autoDetect(int fd = STDOUT_FILENO) // keeps the colors only if fd is a terminal (and NO_COLOR isn't set), returns whether they're on
+{
+	if (isatty(fd) && std::getenv("NO_COLOR") == nullptr)
+		return true;
+	disable();
+	return false;
+} // example: color::autoDetect(); at the start of main, so "./app > out.txt" has no escape codes in it
 } // namespace color
 
 #endif // COLOR_HPP
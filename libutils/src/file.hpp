@@ -1,6 +1,6 @@
 /* Part of https://github.com/HassanIQ777/libutils
 Made on    : 2024-Nov-02
-Last update: 2025-Nov-28 */
+Last update: 2026-Oct-17 */
 
 #ifndef FILE_HPP
 #define FILE_HPP
@@ -9,10 +9,13 @@ Last update: 2025-Nov-28 */
 #include <vector>
 #include <string>
 #include <filesystem>
+#include <chrono>
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
 
+#include "simd.hpp" // simd::count
+
 namespace fs = std::filesystem;
 
 class File
@@ -45,7 +48,7 @@ class File
 	static uintmax_t m_getfilesize(const std::string &filename);			// returns file size in Bytes
 	static bool m_isfile(const std::string &path);							// true if "path" leads to a file
 	static bool m_isdirectory(const std::string &path);						// same but for directories
-	static std::time_t m_lastmodification_t(const std::string &filename);	// returns last modification time of filename as an integer, for example: 1735910400
+	static std::time_t m_lastmodification_t(const std::string &filename);	// returns last modification time of filename as an integer, for example: 1735910400 (0 if it can't be read)
 	static std::string m_lastmodification_str(const std::string &filename); // same but in a readable string format, for example: 2025-01-03 12:00:00
 	static size_t m_numlines(const std::string &filename);						// 2nd useless function, but I use to access the last line in a file
 
@@ -380,9 +383,14 @@ bool File::m_isdirectory(const std::string &path)
 
 std::time_t File::m_lastmodification_t(const std::string &filename)
 {
-	auto ftime = fs::last_write_time(filename);
-	auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-		ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
+	std::error_code error;
+	auto ftime = fs::last_write_time(filename, error);
+	if (error)
+	{
+		return 0;
+	}
+	// to_sys converts exactly, going through both clocks' now() was off by a bit every call
+	auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(std::chrono::file_clock::to_sys(ftime));
 	return std::chrono::system_clock::to_time_t(sctp);
 }
 
@@ -403,20 +411,14 @@ size_t File::m_numlines(const std::string &filename)
 		return 0;
 	}
 
-	constexpr size_t BUFFER_SIZE = 1 << 21; // 2MB buffer
-	char buffer[BUFFER_SIZE];
+	constexpr size_t BUFFER_SIZE = 1 << 21; // 2MB buffer, on the heap so threads with small stacks can call this too
+	std::vector<char> buffer(BUFFER_SIZE);
 	size_t line_count = 0;
 
-	while (file.read(buffer, BUFFER_SIZE) || file.gcount() > 0)
+	while (file.read(buffer.data(), BUFFER_SIZE) || file.gcount() > 0)
 	{
-		std::streamsize bytes_read = file.gcount();
-		for (std::streamsize i = 0; i < bytes_read; ++i)
-		{
-			if (buffer[i] == '\n')
-			{
-				++line_count;
-			}
-		}
+		const char *begin = buffer.data();
+		line_count += simd::count(begin, begin + file.gcount(), '\n');
 	}
 
 	return line_count;
@@ -1,6 +1,6 @@
 /* Part of https://github.com/HassanIQ777/libutils
 Made on    : 2024 Nov 17
-Last update: 2025 Nov 06 */
+Last update: 2026 Oct 17 */
 
 #ifndef FUNCS_HPP
 #define FUNCS_HPP
@@ -9,6 +9,7 @@ Last update: 2025 Nov 06 */
 #include <iomanip>
 #include <cctype>
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <vector>
 #include <thread>
@@ -29,6 +30,8 @@ Last update: 2025 Nov 06 */
 #include <unistd.h>
 #include <type_traits> // std::common_type
 
+#include "simd.hpp"
+
 namespace funcs
 {
 //########################################################################################################################################
@@ -69,6 +72,8 @@ void msleep(size_t milliseconds);
 std::string getKeyPress(); // returns a string of last key press (multiple characters supported!)
 
 inline bool hasSequence(const std::string &text, const std::string &sequence); // returns true if "sequence" was found in "text"
+inline bool hasSequence(const char *begin, const char *end, std::string_view sequence); // same but searches the raw buffer [begin, end), no strings needed
+inline const char *findSequence(const char *begin, const char *end, std::string_view sequence); // returns where "sequence" starts in [begin, end), nullptr if it's not there
 inline std::string m_hash(const std::string text, const uintmax_t length = 32);
 
 bool isNumber(const std::string &s);
@@ -317,9 +322,20 @@ void replaceChar(std::string &text, char old_char, char new_char)
 	std::replace(text.begin(), text.end(), old_char, new_char);
 }
 
+// these run on the SIMD kernel from simd.hpp (picked at startup for the current CPU)
 inline bool hasSequence(const std::string &text, const std::string &sequence)
 {
-	return text.find(sequence) != std::string::npos;
+	return hasSequence(text.data(), text.data() + text.size(), sequence);
+}
+
+inline bool hasSequence(const char *begin, const char *end, std::string_view sequence)
+{
+	return findSequence(begin, end, sequence) != nullptr;
+}
+
+inline const char *findSequence(const char *begin, const char *end, std::string_view sequence)
+{
+	return simd::find(begin, end, sequence.data(), sequence.size());
 }
 
 /*
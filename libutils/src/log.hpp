@@ -1,13 +1,47 @@
 /* Part of https://github.com/HassanIQ777/libutils
 Made on:     2025-Jan-5
-Last update: 2025-Sep-20 */
+Last update: 2026-Oct-17 */
 
 #ifndef LOG_HPP
 #define LOG_HPP
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <cstdlib> // for exit()
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <climits>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* EXAMPLE (async): */
+/*
+Log::AsyncOptions options;
+options.m_fd = log_fd;							   // stdout by default
+options.m_overflow = Log::OverflowPolicy::block; // wait instead of dropping records when a thread's buffer is full
+Log::m_startAsync(options);
+Log::m_warn("written by the flusher thread"); // ~20ns on the calling thread
+Log::m_stopAsync();							  // or let exit() do it
+*/
+
+/* By default every call writes to std::cout on the calling thread. After m_startAsync() a call only formats
+ * the record into a ring buffer of the calling thread (single producer, the flusher is the single consumer,
+ * no locks or syscalls), and a background thread gathers every ring into one writev to the fd every few ms.
+ * Records of one thread stay in order and never interleave with others, records of different threads
+ * are only ordered by when the flusher picked them up.
+ * A full ring drops the record (and the flusher reports how many were dropped) or, with OverflowPolicy::block,
+ * waits for the flusher. exit() (which m_error calls) stops the flusher after writing out what's buffered,
+ * m_stopAsync() does the same earlier. Stop it only once no other thread logs anymore. */
 
 class Log
 {
@@ -20,68 +54,114 @@ class Log
 		log_error
 	};
 
-	static void m_debug(const std::string &message);
-	static void m_info(const std::string &message);
-	static void m_warn(const std::string &message);
-	static void m_error(const std::string &message, bool terminate = true);
+	enum class OverflowPolicy
+	{
+		drop,  // the record is lost, the flusher writes how many were
+		block, // the logging thread waits until the flusher made room
+	};
+
+	struct AsyncOptions
+	{
+		int m_fd = STDOUT_FILENO;
+		size_t m_buffer_size = size_t(64) << 10; // bytes per logging thread, rounded up to a power of two
+		OverflowPolicy m_overflow = OverflowPolicy::drop;
+		unsigned m_flush_interval_ms = 10;
+		bool m_colors = true; // only used when the fd is a terminal
+	};
+
+	static void m_debug(std::string_view message);
+	static void m_info(std::string_view message);
+	static void m_warn(std::string_view message);
+	static void m_error(std::string_view message, bool terminate = true);
 	static void m_setLogLevel(const LogLevel &level);
 
+	static bool m_startAsync(const AsyncOptions &options); // false if it's already running
+	static bool m_startAsync();							   // with the default options
+	static void m_stopAsync();									// writes out everything buffered and joins the flusher
+	static void m_flush();										// writes out everything buffered so far (no-op when synchronous)
+
   private:
 	static bool p_shouldLog(const LogLevel &log_level);
 
 	inline static LogLevel p_current_log_level = LogLevel::log_warn;
+
+	// one logging thread's records, already formatted. head/tail only grow, & mask gives the position
+	struct Ring
+	{
+		explicit Ring(size_t size) : m_data(new char[size]), m_mask(size - 1) {}
+
+		std::unique_ptr<char[]> m_data;
+		const size_t m_mask;
+		alignas(64) std::atomic<uint64_t> m_head{0}; // written by the logging thread
+		uint64_t m_cached_tail = 0;					 // the logging thread's last look at m_tail
+		std::atomic<uint64_t> m_dropped{0};
+		std::atomic<bool> m_retired{false}; // the thread exited, the ring goes once it's drained
+		alignas(64) std::atomic<uint64_t> m_tail{0}; // written by whoever drains
+	};
+
+	struct AsyncState
+	{
+		std::atomic<bool> m_running{false};
+		AsyncOptions m_options;
+		bool m_colors = false;
+		std::mutex m_mutex; // the ring list, and one drain at a time
+		std::vector<std::shared_ptr<Ring>> m_rings;
+		std::thread m_flusher;
+		std::mutex m_wake_mutex;
+		std::condition_variable m_wake;
+		bool m_stop = false; // under m_wake_mutex
+	};
+
+	static AsyncState &p_async()
+	{
+		static AsyncState state;
+		return state;
+	}
+
+	static void p_print(LogLevel level, std::string_view message);
+	static void p_push(LogLevel level, std::string_view message);
+	static Ring &p_threadRing();
+	static void p_drain(AsyncState &state); // holds state.m_mutex
+	static std::string_view p_prefix(LogLevel level, bool colors);
 };
 
-void Log::m_debug(const std::string &message)
+void Log::m_debug(std::string_view message)
 {
 	if (!p_shouldLog(LogLevel::log_debug))
 	{
 		return;
 	}
-
-	std::cout << "\x1b[1m"
-			  << "\x1b[33m" /* Bold Yellow */
-			  << "(DEBUG):"
-			  << "\x1b[0m " << message << "\n";
+	p_print(LogLevel::log_debug, message);
 }
 
-void Log::m_info(const std::string &message)
+void Log::m_info(std::string_view message)
 {
 	if (!p_shouldLog(LogLevel::log_info))
 	{
 		return;
 	}
-
-	std::cout << "\x1b[42m" /* Green */
-			  << "(INFO):"
-			  << "\x1b[0m " << message << "\n";
+	p_print(LogLevel::log_info, message);
 }
 
-void Log::m_warn(const std::string &message)
+void Log::m_warn(std::string_view message)
 {
 	if (!p_shouldLog(LogLevel::log_warn))
 	{
 		return;
 	}
-
-	std::cout << "\x1b[33m" /* Yellow */
-			  << "(WARNING):"
-			  << "\x1b[0m " << message << "\n";
+	p_print(LogLevel::log_warn, message);
 }
 
-void Log::m_error(const std::string &message, bool terminate)
+void Log::m_error(std::string_view message, bool terminate)
 {
 	if (!p_shouldLog(LogLevel::log_error))
 	{
 		return;
 	}
-
-	std::cout << "\x1b[31m" /* Red */
-			  << "(ERROR):"
-			  << "\x1b[0m " << message << "\n";
+	p_print(LogLevel::log_error, message);
 	if (terminate)
 	{
-		exit(EXIT_FAILURE);
+		exit(EXIT_FAILURE); // runs m_stopAsync, nothing buffered is lost
 	}
 }
 
@@ -102,4 +182,238 @@ bool Log::p_shouldLog(const LogLevel &log_level)
 	return (log_level >= p_current_log_level);
 }
 
-#endif // log.hpp
\ No newline at end of file
+inline std::string_view Log::p_prefix(LogLevel level, bool colors)
+{
+	switch (level)
+	{
+	case LogLevel::log_debug:
+		return colors ? "\x1b[1m\x1b[33m(DEBUG):\x1b[0m " /* Bold Yellow */ : "(DEBUG): ";
+	case LogLevel::log_info:
+		return colors ? "\x1b[42m(INFO):\x1b[0m " /* Green */ : "(INFO): ";
+	case LogLevel::log_warn:
+		return colors ? "\x1b[33m(WARNING):\x1b[0m " /* Yellow */ : "(WARNING): ";
+	default:
+		return colors ? "\x1b[31m(ERROR):\x1b[0m " /* Red */ : "(ERROR): ";
+	}
+}
+
+inline void Log::p_print(LogLevel level, std::string_view message)
+{
+	if (p_async().m_running.load(std::memory_order_acquire)) // pairs with m_startAsync, the options are set by then
+	{
+		p_push(level, message);
+		return;
+	}
+	std::cout << p_prefix(level, true) << message << "\n";
+}
+
+//########################################################
+// async backend
+
+inline bool Log::m_startAsync(const AsyncOptions &options)
+{
+	AsyncState &state = p_async();
+	std::lock_guard<std::mutex> lock(state.m_mutex);
+	if (state.m_running.load())
+		return false;
+	std::cout.flush(); // what was logged synchronously comes first
+
+	state.m_options = options;
+	state.m_colors = options.m_colors && ::isatty(options.m_fd) == 1;
+	size_t size = 256;
+	while (size < options.m_buffer_size)
+		size *= 2;
+	state.m_options.m_buffer_size = size;
+	{
+		std::lock_guard<std::mutex> wake_lock(state.m_wake_mutex);
+		state.m_stop = false;
+	}
+	state.m_flusher = std::thread([&state]() {
+		std::unique_lock<std::mutex> wake_lock(state.m_wake_mutex);
+		while (!state.m_stop)
+		{
+			state.m_wake.wait_for(wake_lock, std::chrono::milliseconds(state.m_options.m_flush_interval_ms));
+			wake_lock.unlock();
+			{
+				std::lock_guard<std::mutex> rings_lock(state.m_mutex);
+				p_drain(state);
+			}
+			wake_lock.lock();
+		}
+	});
+
+	static bool registered = false; // exit() (and so m_error) drains the rings
+	if (!registered)
+	{
+		registered = true;
+		std::atexit([]() { Log::m_stopAsync(); });
+	}
+	state.m_running.store(true);
+	return true;
+}
+
+inline bool Log::m_startAsync()
+{
+	return m_startAsync(AsyncOptions());
+}
+
+inline void Log::m_stopAsync()
+{
+	AsyncState &state = p_async();
+	if (!state.m_running.exchange(false))
+		return;
+	{
+		std::lock_guard<std::mutex> wake_lock(state.m_wake_mutex);
+		state.m_stop = true;
+	}
+	state.m_wake.notify_one();
+	state.m_flusher.join();
+	std::lock_guard<std::mutex> lock(state.m_mutex);
+	p_drain(state); // whatever came in during the last round
+}
+
+inline void Log::m_flush()
+{
+	AsyncState &state = p_async();
+	if (!state.m_running.load())
+		return;
+	std::lock_guard<std::mutex> lock(state.m_mutex);
+	p_drain(state);
+}
+
+inline Log::Ring &Log::p_threadRing()
+{
+	// the thread marks its ring retired when it exits, the flusher drops it once it's written out
+	struct Holder
+	{
+		std::shared_ptr<Ring> m_ring;
+		~Holder()
+		{
+			if (m_ring != nullptr)
+				m_ring->m_retired.store(true, std::memory_order_release);
+		}
+	};
+	static thread_local Holder holder;
+	AsyncState &state = p_async();
+	if (holder.m_ring == nullptr || holder.m_ring->m_mask + 1 != state.m_options.m_buffer_size)
+	{
+		if (holder.m_ring != nullptr)
+			holder.m_ring->m_retired.store(true, std::memory_order_release);
+		auto ring = std::make_shared<Ring>(state.m_options.m_buffer_size);
+		std::lock_guard<std::mutex> lock(state.m_mutex);
+		state.m_rings.push_back(ring);
+		holder.m_ring = std::move(ring);
+	}
+	return *holder.m_ring;
+}
+
+inline void Log::p_push(LogLevel level, std::string_view message)
+{
+	AsyncState &state = p_async();
+	Ring &ring = p_threadRing();
+	const size_t capacity = ring.m_mask + 1;
+	const std::string_view prefix = p_prefix(level, state.m_colors);
+	if (prefix.size() + message.size() + 1 > capacity) // would never fit, keep what does
+		message = message.substr(0, capacity - prefix.size() - 1);
+	const size_t length = prefix.size() + message.size() + 1;
+
+	const uint64_t head = ring.m_head.load(std::memory_order_relaxed);
+	if (capacity - (head - ring.m_cached_tail) < length)
+	{
+		ring.m_cached_tail = ring.m_tail.load(std::memory_order_acquire);
+		while (capacity - (head - ring.m_cached_tail) < length)
+		{
+			if (state.m_options.m_overflow == OverflowPolicy::drop)
+			{
+				ring.m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			state.m_wake.notify_one(); // don't wait out the flush interval
+			std::this_thread::yield();
+			ring.m_cached_tail = ring.m_tail.load(std::memory_order_acquire);
+		}
+	}
+
+	char *data = ring.m_data.get();
+	uint64_t position = head;
+	auto copy = [&](const char *text, size_t size) {
+		const size_t offset = static_cast<size_t>(position) & ring.m_mask;
+		const size_t first = std::min(size, capacity - offset);
+		std::memcpy(data + offset, text, first);
+		std::memcpy(data, text + first, size - first);
+		position += size;
+	};
+	copy(prefix.data(), prefix.size());
+	copy(message.data(), message.size());
+	copy("\n", 1);
+	ring.m_head.store(head + length, std::memory_order_release);
+}
+
+inline void Log::p_drain(AsyncState &state)
+{
+	std::vector<iovec> parts;
+	std::vector<std::string> notes; // "N records dropped", alive until the write
+	std::vector<std::pair<Ring *, uint64_t>> taken;
+	notes.reserve(state.m_rings.size());
+	for (const auto &ring : state.m_rings)
+	{
+		const bool retired = ring->m_retired.load(std::memory_order_acquire); // before head, so nothing after it is missed
+		const uint64_t dropped = ring->m_dropped.exchange(0, std::memory_order_relaxed);
+		if (dropped > 0)
+		{
+			notes.push_back(std::string(p_prefix(LogLevel::log_warn, state.m_colors)) + std::to_string(dropped) + " log records dropped, the buffer was full\n");
+			parts.push_back({notes.back().data(), notes.back().size()});
+		}
+		const uint64_t head = ring->m_head.load(std::memory_order_acquire);
+		const uint64_t tail = ring->m_tail.load(std::memory_order_relaxed);
+		if (head != tail)
+		{
+			const size_t capacity = ring->m_mask + 1;
+			const size_t offset = static_cast<size_t>(tail) & ring->m_mask;
+			const size_t size = static_cast<size_t>(head - tail);
+			const size_t first = std::min(size, capacity - offset);
+			parts.push_back({ring->m_data.get() + offset, first});
+			if (size > first)
+				parts.push_back({ring->m_data.get(), size - first});
+		}
+		taken.push_back({retired && head == tail ? nullptr : ring.get(), head});
+	}
+
+	// one writev for everything (IOV_MAX parts at a time), a partial write carries on where it stopped
+	size_t done = 0;
+	while (done < parts.size())
+	{
+		const int count = static_cast<int>(std::min<size_t>(parts.size() - done, IOV_MAX));
+		const ssize_t written = ::writev(state.m_options.m_fd, parts.data() + done, count);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break; // nowhere to write to, the records are dropped all the same
+		}
+		size_t left = static_cast<size_t>(written);
+		while (done < parts.size() && left >= parts[done].iov_len)
+			left -= parts[done++].iov_len;
+		if (done < parts.size())
+		{
+			parts[done].iov_base = static_cast<char *>(parts[done].iov_base) + left;
+			parts[done].iov_len -= left;
+		}
+	}
+
+	for (size_t i = 0; i < taken.size(); i++)
+	{
+		if (taken[i].first != nullptr)
+			taken[i].first->m_tail.store(taken[i].second, std::memory_order_release);
+	}
+	// rings of threads that exited and had nothing left
+	size_t kept = 0;
+	for (size_t i = 0; i < state.m_rings.size(); i++)
+	{
+		if (taken[i].first != nullptr)
+			state.m_rings[kept++] = std::move(state.m_rings[i]);
+	}
+	state.m_rings.resize(kept);
+}
+
+#endif // log.hpp
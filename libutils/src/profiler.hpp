@@ -0,0 +1,264 @@
+/* Part of https://github.com/HassanIQ777/libutils
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp" // CycleCounter
+#include "table.hpp"
+
+/* EXAMPLE: */
+/*
+enum class Zone { parse, lookup }; // ids are compile time, up to profiler::MAX_ZONES
+const char *const ZONE_NAMES[] = {"parse", "lookup"};
+
+profiler::enable();
+{
+	profiler::Scope<Zone::parse> zone;
+	zone.m_addBytes(text.size());
+	parse(text); // a Scope<Zone::lookup> in here shows up nested under parse
+}
+std::cerr << profiler::table(ZONE_NAMES);
+*/
+
+/* Zones are ScopedTimer without the std::function and the std::string: the id is a template argument,
+ * the time comes from CycleCounter::m_read() and goes into counters of the calling thread, no lock and no
+ * allocation (a thread's counters are allocated the first time it enters a zone, and reused by later threads
+ * once it exits). A zone costs two counter reads, a disabled one a load and a branch.
+ * Zones nest: every zone is counted per direct parent, its self time leaves out the zones inside it.
+ * Work done thousands of times per second (per hit...) is better timed in batches, see m_countAs().
+ * table() adds up every thread, so time is CPU time and can be more than the wall time. Only the owning
+ * thread writes its counters (relaxed load + store, plain movs), table() can read them while it's running. */
+
+namespace profiler
+{
+constexpr unsigned MAX_ZONES = 16;
+constexpr unsigned ROOT = MAX_ZONES; // the parent of zones that aren't inside another one
+
+namespace detail
+{
+inline bool enabled = false;
+
+struct Counter
+{
+	std::atomic<uint64_t> m_ticks{0}; // including the zones inside
+	std::atomic<uint64_t> m_self_ticks{0};
+	std::atomic<uint64_t> m_calls{0};
+	std::atomic<uint64_t> m_bytes{0};
+};
+
+inline void add(std::atomic<uint64_t> &counter, uint64_t value) // only ever called by the owning thread
+{
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct ThreadCounters
+{
+	Counter m_zones[MAX_ZONES + 1][MAX_ZONES]; // [parent][zone]
+	unsigned m_current = ROOT;				   // the innermost zone the thread is in
+	uint64_t m_child_ticks = 0;				   // time spent in zones inside m_current so far
+};
+
+struct Registry
+{
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<ThreadCounters>> m_all;
+	std::vector<ThreadCounters *> m_free; // of threads that exited, their counts stay in
+};
+
+inline Registry &registry()
+{
+	static Registry registry;
+	return registry;
+}
+
+// hands a thread its counters and gives them back when it exits
+class ThreadSlot
+{
+  public:
+	ThreadSlot()
+	{
+		Registry &all = registry();
+		std::lock_guard<std::mutex> lock(all.m_mutex);
+		if (!all.m_free.empty())
+		{
+			p_counters = all.m_free.back();
+			all.m_free.pop_back();
+		}
+		else
+		{
+			all.m_all.push_back(std::make_unique<ThreadCounters>());
+			p_counters = all.m_all.back().get();
+		}
+		p_counters->m_current = ROOT;
+		p_counters->m_child_ticks = 0;
+	}
+
+	~ThreadSlot()
+	{
+		Registry &all = registry();
+		std::lock_guard<std::mutex> lock(all.m_mutex);
+		all.m_free.push_back(p_counters);
+	}
+
+	ThreadSlot(const ThreadSlot &) = delete;
+	ThreadSlot &operator=(const ThreadSlot &) = delete;
+
+	ThreadCounters &m_counters() { return *p_counters; }
+
+  private:
+	ThreadCounters *p_counters;
+};
+
+inline ThreadCounters &threadCounters()
+{
+	static thread_local ThreadSlot slot;
+	return slot.m_counters();
+}
+} // namespace detail
+
+// zones only count once this was called (before the threads that use them start)
+inline void enable(bool on = true) { detail::enabled = on; }
+inline bool isEnabled() { return detail::enabled; }
+
+// Times the scope it lives in as zone ID (an enum or integer below MAX_ZONES)
+template <auto ID>
+class Scope
+{
+	static constexpr unsigned ZONE = static_cast<unsigned>(ID);
+	static_assert(ZONE < MAX_ZONES, "zone id out of range");
+
+  public:
+	Scope()
+	{
+		if (!detail::enabled)
+			return;
+		p_thread = &detail::threadCounters();
+		p_parent = p_thread->m_current;
+		p_saved_child_ticks = p_thread->m_child_ticks;
+		p_thread->m_current = ZONE;
+		p_thread->m_child_ticks = 0;
+		p_start = CycleCounter::m_read();
+	}
+
+	~Scope()
+	{
+		if (p_thread == nullptr)
+			return;
+		const uint64_t elapsed = CycleCounter::m_read() - p_start;
+		detail::Counter &counter = p_thread->m_zones[p_parent][ZONE];
+		detail::add(counter.m_ticks, elapsed);
+		detail::add(counter.m_self_ticks, elapsed > p_thread->m_child_ticks ? elapsed - p_thread->m_child_ticks : 0);
+		detail::add(counter.m_calls, p_calls);
+		if (p_bytes > 0)
+			detail::add(counter.m_bytes, p_bytes);
+		p_thread->m_current = p_parent;
+		p_thread->m_child_ticks = p_saved_child_ticks + elapsed;
+	}
+
+	Scope(const Scope &) = delete;
+	Scope &operator=(const Scope &) = delete;
+
+	void m_addBytes(uint64_t bytes) { p_bytes += bytes; } // what the zone went through, for the throughput
+	void m_countAs(uint64_t calls) { p_calls = calls; }	  // one scope around a batch of small things (hits) counts them all
+
+  private:
+	detail::ThreadCounters *p_thread = nullptr; // nullptr when profiling is off
+	unsigned p_parent = ROOT;
+	uint64_t p_saved_child_ticks = 0;
+	uint64_t p_start = 0;
+	uint64_t p_bytes = 0;
+	uint64_t p_calls = 1;
+};
+
+// one zone under one parent, added up over every thread
+struct ZoneTotals
+{
+	unsigned m_zone = 0;
+	unsigned m_parent = ROOT;
+	unsigned m_depth = 0; // 0 for top level zones
+	uint64_t m_calls = 0;
+	uint64_t m_bytes = 0;
+	double m_seconds = 0;	   // including the zones inside
+	double m_self_seconds = 0; // without them
+};
+
+// every zone that was entered, in tree order (children under their parent, by id)
+inline std::vector<ZoneTotals> collect()
+{
+	ZoneTotals sums[MAX_ZONES + 1][MAX_ZONES] = {};
+	{
+		detail::Registry &all = detail::registry();
+		std::lock_guard<std::mutex> lock(all.m_mutex);
+		for (const auto &thread : all.m_all)
+		{
+			for (unsigned parent = 0; parent <= MAX_ZONES; parent++)
+			{
+				for (unsigned zone = 0; zone < MAX_ZONES; zone++)
+				{
+					const detail::Counter &counter = thread->m_zones[parent][zone];
+					ZoneTotals &sum = sums[parent][zone];
+					sum.m_calls += counter.m_calls.load(std::memory_order_relaxed);
+					sum.m_bytes += counter.m_bytes.load(std::memory_order_relaxed);
+					sum.m_seconds += static_cast<double>(counter.m_ticks.load(std::memory_order_relaxed));
+					sum.m_self_seconds += static_cast<double>(counter.m_self_ticks.load(std::memory_order_relaxed));
+				}
+			}
+		}
+	}
+
+	std::vector<ZoneTotals> zones;
+	const double ticks_per_second = CycleCounter::m_ticksPerSecond();
+	auto visit = [&](auto &self, unsigned parent, unsigned depth, uint32_t ancestors) -> void {
+		for (unsigned zone = 0; zone < MAX_ZONES; zone++)
+		{
+			ZoneTotals sum = sums[parent][zone];
+			if (sum.m_calls == 0)
+				continue;
+			sum.m_zone = zone;
+			sum.m_parent = parent;
+			sum.m_depth = depth;
+			sum.m_seconds /= ticks_per_second;
+			sum.m_self_seconds /= ticks_per_second;
+			zones.push_back(sum);
+			if ((ancestors & (1u << zone)) == 0) // a zone inside itself is listed once
+				self(self, zone, depth + 1, ancestors | (1u << zone));
+		}
+	};
+	visit(visit, ROOT, 0, 0);
+	return zones;
+}
+
+// zone | calls | time ms | self ms | MB | MB/s, names[id] names the zones. MB/s is over the self time
+template <size_t N>
+Table table(const char *const (&names)[N])
+{
+	auto fixed = [](double value, int digits) -> std::string {
+		char text[32];
+		std::snprintf(text, sizeof(text), "%.*f", digits, value);
+		return text;
+	};
+	Table result;
+	result.m_setHeader("zone", "calls", "time ms", "self ms", "MB", "MB/s");
+	for (const ZoneTotals &zone : collect())
+	{
+		const std::string name = std::string(zone.m_depth * 2, ' ') + (zone.m_zone < N ? names[zone.m_zone] : std::to_string(zone.m_zone));
+		const double megabytes = static_cast<double>(zone.m_bytes) / 1e6;
+		result.m_addRow(name, zone.m_calls, fixed(zone.m_seconds * 1e3, 2), fixed(zone.m_self_seconds * 1e3, 2),
+						zone.m_bytes > 0 ? fixed(megabytes, 1) : "-", zone.m_bytes > 0 && zone.m_self_seconds > 0 ? fixed(megabytes / zone.m_self_seconds, 0) : "-");
+	}
+	return result;
+}
+} // namespace profiler
+
+#endif // profiler.hpp
@@ -0,0 +1,1013 @@
+/* Part of https://github.com/HassanIQ777/libutils
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef REGEX_HPP
+#define REGEX_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <array>
+#include <algorithm>
+#include <limits>
+
+#include "simd.hpp" // simd::foldAscii
+
+/* EXAMPLE: */
+/*
+Regex regex;
+if (!regex.m_compile("(ERROR|FATAL): [0-9]+ ms$"))
+	std::cout << regex.m_error() << "\n";
+
+regex.m_matchLine(line);				   // does the line contain a match
+regex.m_requiredLiterals();				   // {"ERROR", "FATAL"}, at least one of them is in every match
+*/
+
+/* Line oriented regular expressions that always run in linear time:
+ * the pattern is parsed into a small AST, compiled to a Thompson NFA, and the NFA is turned into
+ * a DFA lazily, one state at a time, only for the states the input actually reaches.
+ * The DFA states live in a bounded cache that gets flushed when it's full, so memory stays fixed
+ * and there is no backtracking (and no blowups on patterns like (a*)*b).
+ *
+ * Supported: literals, . [abc] [^a-z] \d \w \s \D \W \S, escapes (\. \\ \t \n ...), ( ) (?: ),
+ * |, * + ? {m} {m,} {m,n} (lazy '?' suffixes are accepted, they don't change whether a line matches),
+ * ^ and $ as line anchors.
+ * A Regex keeps its DFA cache inside, so every thread needs its own copy. */
+
+class Regex
+{
+  public:
+	static constexpr size_t DEFAULT_CACHE_BYTES = size_t(8) << 20;
+	static constexpr int MAX_REPEAT = 1000;
+	static constexpr size_t MAX_NFA_NODES = 200000;
+	static constexpr int MAX_NESTING = 1000; // levels of groups and nodes, parsing and compiling recurse through them
+
+	bool m_compile(const std::string &pattern, bool case_insensitive = false); // false on a syntax error, see m_error()
+	const std::string &m_error() const { return p_error; }
+	const std::string &m_pattern() const { return p_pattern; }
+
+	bool m_matchLine(const char *begin, const char *end); // [begin, end) is a single line without the '\n'
+	bool m_matchLine(std::string_view line) { return m_matchLine(line.data(), line.data() + line.size()); }
+	const char *m_findLine(const char *begin, const char *end); // begin has to be at the start of a line, returns the start of the first matching line
+
+	const std::vector<std::string> &m_requiredLiterals() const { return p_required; } // every match contains one of these (folded with case_insensitive), empty if there's no such set
+	void m_setCacheSize(size_t bytes) { p_cache_limit = bytes; }
+	size_t m_cacheFlushes() const { return p_flushes; }
+	size_t m_dfaStates() const { return p_states.size(); }
+
+  private:
+	//########################################################
+	// AST
+	struct ByteSet
+	{
+		std::array<uint64_t, 4> m_bits = {};
+
+		void m_set(unsigned byte) { m_bits[byte >> 6] |= uint64_t(1) << (byte & 63); }
+		bool m_test(unsigned byte) const { return (m_bits[byte >> 6] >> (byte & 63)) & 1; }
+		void m_setRange(unsigned from, unsigned to)
+		{
+			for (unsigned b = from; b <= to; b++)
+				m_set(b);
+		}
+		void m_invert()
+		{
+			for (auto &word : m_bits)
+				word = ~word;
+		}
+		void m_merge(const ByteSet &other)
+		{
+			for (size_t i = 0; i < 4; i++)
+				m_bits[i] |= other.m_bits[i];
+		}
+		size_t m_count() const
+		{
+			size_t count = 0;
+			for (auto word : m_bits)
+				count += static_cast<size_t>(__builtin_popcountll(word));
+			return count;
+		}
+	};
+
+	enum class Kind
+	{
+		kind_class,
+		kind_empty,
+		kind_bol,
+		kind_eol,
+		kind_concat,
+		kind_alternate,
+		kind_repeat
+	};
+
+	struct AstNode
+	{
+		Kind m_kind;
+		ByteSet m_set;
+		std::vector<size_t> m_children;
+		int m_min = 0;
+		int m_max = 0;	 // -1 = no upper bound
+		int m_depth = 1; // levels of nodes from this one down
+	};
+
+	//########################################################
+	// NFA
+	enum class NfaKind : uint8_t
+	{
+		nfa_class,
+		nfa_split,
+		nfa_bol,
+		nfa_eol,
+		nfa_match
+	};
+
+	struct NfaNode
+	{
+		NfaKind m_kind;
+		uint32_t m_out = 0;
+		uint32_t m_out2 = 0;	// only for splits
+		uint32_t m_set = 0;	// index into p_sets, only for classes
+	};
+
+	//########################################################
+	// DFA
+	static constexpr uint32_t UNKNOWN = std::numeric_limits<uint32_t>::max();
+
+	struct DfaState
+	{
+		std::vector<uint32_t> m_nfa; // sorted NFA nodes (classes, match and $ waiting for the end of the line)
+		bool m_match = false;		 // a match has been seen, the line matches
+		bool m_eol_match = false;	 // the line matches if it ends here
+	};
+
+	std::string p_pattern;
+	std::string p_error;
+	bool p_nocase = false;
+
+	std::vector<AstNode> p_ast;
+	std::vector<ByteSet> p_sets;
+	std::vector<NfaNode> p_nfa;
+	uint32_t p_start = 0; // line start, goes through the unanchored [^\n]* loop
+	std::vector<std::string> p_required;
+
+	uint8_t p_byte_class[256] = {};
+	uint32_t p_class_count = 1;
+	std::vector<DfaState> p_states; // state 0 is always the line start
+	std::vector<uint32_t> p_table;	// p_states.size() * p_class_count transitions
+	std::map<std::vector<uint32_t>, uint32_t> p_index;
+	size_t p_cache_bytes = 0;
+	size_t p_cache_limit = DEFAULT_CACHE_BYTES;
+	size_t p_flushes = 0;
+	bool p_empty_match = false; // for empty lines, where ^ and $ both hold ($^)
+
+	// parsing
+	int p_groups = 0; // '(' the parser is inside of
+	bool p_parse(std::string_view pattern, size_t &pos, size_t &node);
+	bool p_parseConcat(std::string_view pattern, size_t &pos, size_t &node);
+	bool p_parseRepeat(std::string_view pattern, size_t &pos, size_t &node);
+	bool p_parseAtom(std::string_view pattern, size_t &pos, size_t &node);
+	bool p_parseClass(std::string_view pattern, size_t &pos, ByteSet &set);
+	bool p_parseEscape(std::string_view pattern, size_t &pos, ByteSet &set);
+	static void p_foldSet(ByteSet &set) // a letter in the set brings its other case along
+	{
+		for (unsigned b = 'a'; b <= 'z'; b++)
+		{
+			if (set.m_test(b) || set.m_test(b & ~0x20u))
+			{
+				set.m_set(b);
+				set.m_set(b & ~0x20u);
+			}
+		}
+	}
+	size_t p_newNode(Kind kind)
+	{
+		p_ast.push_back(AstNode{kind, {}, {}, 0, 0, 1});
+		return p_ast.size() - 1;
+	}
+	bool p_addChild(size_t parent, size_t child) // fails once the tree gets deeper than MAX_NESTING
+	{
+		p_ast[parent].m_children.push_back(child);
+		p_ast[parent].m_depth = std::max(p_ast[parent].m_depth, p_ast[child].m_depth + 1);
+		return p_ast[parent].m_depth <= MAX_NESTING || p_fail("pattern nests too deeply");
+	}
+	bool p_fail(const std::string &message)
+	{
+		p_error = message;
+		return false;
+	}
+
+	// compiling
+	uint32_t p_newNfa(NfaKind kind, uint32_t out, uint32_t out2 = 0, uint32_t set = 0)
+	{
+		p_nfa.push_back(NfaNode{kind, out, out2, set});
+		return static_cast<uint32_t>(p_nfa.size() - 1);
+	}
+	bool p_emit(size_t node, uint32_t next, uint32_t &start);
+	void p_buildByteClasses();
+
+	// literal analysis
+	struct LiteralInfo
+	{
+		bool m_exact_known = false;
+		std::vector<std::string> m_exact; // the node matches exactly one of these
+		std::vector<std::string> m_required;
+	};
+	LiteralInfo p_literals(size_t node) const;
+
+	// lazy DFA
+	void p_closure(uint32_t node, bool bol, std::vector<uint32_t> &set, std::vector<uint8_t> &seen) const;
+	bool p_matchesAtEol(const std::vector<uint32_t> &nfa, bool bol) const; // bol: the line is empty, so ^ still holds
+	uint32_t p_addState(std::vector<uint32_t> &&nfa);
+	uint32_t p_step(uint32_t state, uint32_t byte_class, uint8_t byte);
+	void p_flush();
+	void p_resetCache();
+};
+
+//########################################################
+// Parsing
+
+bool Regex::m_compile(const std::string &pattern, bool case_insensitive)
+{
+	p_pattern = pattern;
+	p_error.clear();
+	p_nocase = case_insensitive;
+	p_ast.clear();
+	p_sets.clear();
+	p_nfa.clear();
+	p_required.clear();
+	p_groups = 0;
+
+	size_t pos = 0;
+	size_t root = 0;
+	if (!p_parse(pattern, pos, root))
+		return false;
+	if (pos != pattern.size())
+		return p_fail("unmatched ')' at position " + std::to_string(pos));
+
+	// NFA: line start -> [^\n]* loop -> pattern -> match
+	const uint32_t match = p_newNfa(NfaKind::nfa_match, 0);
+	uint32_t pattern_start = 0;
+	if (!p_emit(root, match, pattern_start))
+		return false;
+
+	ByteSet any;
+	any.m_setRange(0, 255);
+	p_sets.push_back(any);
+	const uint32_t loop = p_newNfa(NfaKind::nfa_split, 0, pattern_start);
+	p_nfa[loop].m_out = p_newNfa(NfaKind::nfa_class, loop, 0, static_cast<uint32_t>(p_sets.size() - 1));
+	p_start = loop;
+
+	LiteralInfo info = p_literals(root);
+	auto score = [](const std::vector<std::string> &set) -> size_t {
+		size_t shortest = set.empty() ? 0 : std::numeric_limits<size_t>::max();
+		for (const auto &s : set)
+			shortest = std::min(shortest, s.size());
+		return shortest;
+	};
+	const std::vector<std::string> &best = (info.m_exact_known && score(info.m_exact) >= score(info.m_required)) ? info.m_exact : info.m_required;
+	if (score(best) > 0)
+		p_required = best;
+
+	p_buildByteClasses();
+	p_resetCache();
+	p_ast.clear();
+	return true;
+}
+
+bool Regex::p_parse(std::string_view pattern, size_t &pos, size_t &node)
+{
+	size_t first = 0;
+	if (!p_parseConcat(pattern, pos, first))
+		return false;
+	if (pos >= pattern.size() || pattern[pos] != '|')
+	{
+		node = first;
+		return true;
+	}
+
+	node = p_newNode(Kind::kind_alternate);
+	if (!p_addChild(node, first))
+		return false;
+	while (pos < pattern.size() && pattern[pos] == '|')
+	{
+		pos++;
+		size_t branch = 0;
+		if (!p_parseConcat(pattern, pos, branch))
+			return false;
+		if (!p_addChild(node, branch))
+			return false;
+	}
+	return true;
+}
+
+bool Regex::p_parseConcat(std::string_view pattern, size_t &pos, size_t &node)
+{
+	node = p_newNode(Kind::kind_concat);
+	while (pos < pattern.size() && pattern[pos] != '|' && pattern[pos] != ')')
+	{
+		size_t child = 0;
+		if (!p_parseRepeat(pattern, pos, child))
+			return false;
+		if (!p_addChild(node, child))
+			return false;
+	}
+	return true;
+}
+
+bool Regex::p_parseRepeat(std::string_view pattern, size_t &pos, size_t &node)
+{
+	if (!p_parseAtom(pattern, pos, node))
+		return false;
+
+	while (pos < pattern.size())
+	{
+		int min = 0, max = 0;
+		const char c = pattern[pos];
+		if (c == '*')
+			min = 0, max = -1, pos++;
+		else if (c == '+')
+			min = 1, max = -1, pos++;
+		else if (c == '?')
+			min = 0, max = 1, pos++;
+		else if (c == '{')
+		{
+			// {m}, {m,}, {m,n}, anything else is a literal '{'
+			size_t i = pos + 1;
+			auto number = [&](int &value) -> bool {
+				size_t begin = i;
+				value = 0;
+				while (i < pattern.size() && pattern[i] >= '0' && pattern[i] <= '9' && value <= MAX_REPEAT)
+					value = value * 10 + (pattern[i++] - '0');
+				return i > begin;
+			};
+			if (!number(min))
+				break;
+			max = min;
+			if (i < pattern.size() && pattern[i] == ',')
+			{
+				i++;
+				if (!number(max))
+					max = -1;
+			}
+			if (i >= pattern.size() || pattern[i] != '}')
+				break;
+			if (min > MAX_REPEAT || max > MAX_REPEAT)
+				return p_fail("repeat count bigger than " + std::to_string(MAX_REPEAT));
+			if (max != -1 && max < min)
+				return p_fail("bad repeat {" + std::to_string(min) + "," + std::to_string(max) + "}");
+			pos = i + 1;
+		}
+		else
+			break;
+
+		if (pos < pattern.size() && pattern[pos] == '?') // lazy, same thing for line matching
+			pos++;
+
+		const size_t repeat = p_newNode(Kind::kind_repeat);
+		if (!p_addChild(repeat, node)) // a*** stacks repeats without recursing
+			return false;
+		p_ast[repeat].m_min = min;
+		p_ast[repeat].m_max = max;
+		node = repeat;
+	}
+	return true;
+}
+
+bool Regex::p_parseAtom(std::string_view pattern, size_t &pos, size_t &node)
+{
+	const char c = pattern[pos];
+	switch (c)
+	{
+	case '(':
+	{
+		pos++;
+		if (pattern.substr(pos, 2) == "?:")
+			pos += 2;
+		if (++p_groups > MAX_NESTING) // checked before recursing, the tree's depth is only known on the way back
+			return p_fail("pattern nests too deeply");
+		if (!p_parse(pattern, pos, node))
+			return false;
+		p_groups--;
+		if (pos >= pattern.size() || pattern[pos] != ')')
+			return p_fail("missing ')'");
+		pos++;
+		return true;
+	}
+	case '*':
+	case '+':
+	case '?':
+		return p_fail(std::string("nothing to repeat before '") + c + "' at position " + std::to_string(pos));
+	case '^':
+		pos++;
+		node = p_newNode(Kind::kind_bol);
+		return true;
+	case '$':
+		pos++;
+		node = p_newNode(Kind::kind_eol);
+		return true;
+	case '.':
+		pos++;
+		node = p_newNode(Kind::kind_class);
+		p_ast[node].m_set.m_setRange(0, 255);
+		return true;
+	case '[':
+	{
+		pos++;
+		ByteSet set;
+		if (!p_parseClass(pattern, pos, set))
+			return false;
+		node = p_newNode(Kind::kind_class);
+		p_ast[node].m_set = set;
+		return true;
+	}
+	case '\\':
+	{
+		pos++;
+		ByteSet set;
+		if (!p_parseEscape(pattern, pos, set))
+			return false;
+		node = p_newNode(Kind::kind_class);
+		p_ast[node].m_set = set;
+		return true;
+	}
+	default:
+		pos++;
+		node = p_newNode(Kind::kind_class);
+		p_ast[node].m_set.m_set(static_cast<uint8_t>(c));
+		return true;
+	}
+}
+
+bool Regex::p_parseEscape(std::string_view pattern, size_t &pos, ByteSet &set)
+{
+	if (pos >= pattern.size())
+		return p_fail("trailing '\\'");
+
+	const char c = pattern[pos++];
+	bool invert = false;
+	switch (c)
+	{
+	case 'D':
+		invert = true;
+		[[fallthrough]];
+	case 'd':
+		set.m_setRange('0', '9');
+		break;
+	case 'W':
+		invert = true;
+		[[fallthrough]];
+	case 'w':
+		set.m_setRange('a', 'z');
+		set.m_setRange('A', 'Z');
+		set.m_setRange('0', '9');
+		set.m_set('_');
+		break;
+	case 'S':
+		invert = true;
+		[[fallthrough]];
+	case 's':
+		for (char space : std::string_view(" \t\r\f\v\n"))
+			set.m_set(static_cast<uint8_t>(space));
+		break;
+	case 't':
+		set.m_set('\t');
+		break;
+	case 'n':
+		set.m_set('\n');
+		break;
+	case 'r':
+		set.m_set('\r');
+		break;
+	case 'f':
+		set.m_set('\f');
+		break;
+	case 'v':
+		set.m_set('\v');
+		break;
+	default:
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+			return p_fail(std::string("unsupported escape '\\") + c + "'");
+		set.m_set(static_cast<uint8_t>(c)); // \. \\ \( \[ ...
+		break;
+	}
+	if (invert)
+		set.m_invert();
+	return true;
+}
+
+bool Regex::p_parseClass(std::string_view pattern, size_t &pos, ByteSet &set)
+{
+	bool invert = false;
+	if (pos < pattern.size() && pattern[pos] == '^')
+	{
+		invert = true;
+		pos++;
+	}
+
+	bool first = true;
+	while (pos < pattern.size() && (pattern[pos] != ']' || first))
+	{
+		first = false;
+		ByteSet item;
+		int low = -1; // set when the item is a single byte, so it can start a range
+		if (pattern[pos] == '\\')
+		{
+			pos++;
+			if (!p_parseEscape(pattern, pos, item))
+				return false;
+			if (item.m_count() == 1)
+			{
+				for (unsigned b = 0; b < 256; b++)
+				{
+					if (item.m_test(b))
+						low = static_cast<int>(b);
+				}
+			}
+		}
+		else
+		{
+			low = static_cast<uint8_t>(pattern[pos++]);
+			item.m_set(static_cast<unsigned>(low));
+		}
+
+		// a-z
+		if (low != -1 && pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']')
+		{
+			pos++;
+			int high;
+			if (pattern[pos] == '\\')
+			{
+				pos++;
+				ByteSet escaped;
+				if (!p_parseEscape(pattern, pos, escaped) || escaped.m_count() != 1)
+					return p_fail("bad range in character class");
+				high = 0;
+				for (unsigned b = 0; b < 256; b++)
+				{
+					if (escaped.m_test(b))
+						high = static_cast<int>(b);
+				}
+			}
+			else
+				high = static_cast<uint8_t>(pattern[pos++]);
+			if (high < low)
+				return p_fail("bad range in character class");
+			item.m_setRange(static_cast<unsigned>(low), static_cast<unsigned>(high));
+		}
+		set.m_merge(item);
+	}
+
+	if (pos >= pattern.size())
+		return p_fail("missing ']'");
+	pos++; // ']'
+	if (invert)
+	{
+		if (p_nocase) // [^a-z] with -i doesn't match 'A' either, so fold before inverting
+			p_foldSet(set);
+		set.m_invert();
+	}
+	return true;
+}
+
+//########################################################
+// Compiling
+
+bool Regex::p_emit(size_t node, uint32_t next, uint32_t &start)
+{
+	if (p_nfa.size() > MAX_NFA_NODES)
+		return p_fail("pattern is too big");
+
+	const AstNode &ast = p_ast[node];
+	switch (ast.m_kind)
+	{
+	case Kind::kind_class:
+	{
+		ByteSet set = ast.m_set;
+		if (p_nocase)
+			p_foldSet(set);
+		p_sets.push_back(set);
+		start = p_newNfa(NfaKind::nfa_class, next, 0, static_cast<uint32_t>(p_sets.size() - 1));
+		return true;
+	}
+	case Kind::kind_empty:
+		start = next;
+		return true;
+	case Kind::kind_bol:
+		start = p_newNfa(NfaKind::nfa_bol, next);
+		return true;
+	case Kind::kind_eol:
+		start = p_newNfa(NfaKind::nfa_eol, next);
+		return true;
+	case Kind::kind_concat:
+	{
+		const std::vector<size_t> children = ast.m_children;
+		for (size_t i = children.size(); i-- > 0;)
+		{
+			if (!p_emit(children[i], next, next))
+				return false;
+		}
+		start = next;
+		return true;
+	}
+	case Kind::kind_alternate:
+	{
+		const std::vector<size_t> children = ast.m_children;
+		uint32_t rest = 0;
+		if (!p_emit(children.back(), next, rest))
+			return false;
+		for (size_t i = children.size() - 1; i-- > 0;)
+		{
+			uint32_t branch = 0;
+			if (!p_emit(children[i], next, branch))
+				return false;
+			rest = p_newNfa(NfaKind::nfa_split, branch, rest);
+		}
+		start = rest;
+		return true;
+	}
+	case Kind::kind_repeat:
+	{
+		const size_t child = ast.m_children[0];
+		const int min = ast.m_min;
+		const int max = ast.m_max;
+		uint32_t tail = next;
+
+		if (max == -1)
+		{
+			// x* : split(x -> split, next)
+			const uint32_t loop = p_newNfa(NfaKind::nfa_split, 0, next);
+			uint32_t body = 0;
+			if (!p_emit(child, loop, body))
+				return false;
+			p_nfa[loop].m_out = body;
+			tail = loop;
+		}
+		else
+		{
+			// x{0,k} : nested optionals, (x(x)?)?
+			for (int i = 0; i < max - min; i++)
+			{
+				uint32_t body = 0;
+				if (!p_emit(child, tail, body))
+					return false;
+				tail = p_newNfa(NfaKind::nfa_split, body, next);
+			}
+		}
+
+		for (int i = 0; i < min; i++)
+		{
+			if (!p_emit(child, tail, tail))
+				return false;
+		}
+		start = tail;
+		return true;
+	}
+	}
+	return p_fail("internal error");
+}
+
+void Regex::p_buildByteClasses()
+{
+	// bytes that no class tells apart share a column in the transition table
+	std::array<bool, 256> boundary = {};
+	boundary['\n'] = true;
+	if ('\n' + 1 < 256)
+		boundary['\n' + 1] = true;
+	for (const auto &set : p_sets)
+	{
+		for (unsigned b = 1; b < 256; b++)
+		{
+			if (set.m_test(b) != set.m_test(b - 1))
+				boundary[b] = true;
+		}
+	}
+
+	uint32_t current = 0;
+	for (unsigned b = 0; b < 256; b++)
+	{
+		if (b != 0 && boundary[b])
+			current++;
+		p_byte_class[b] = static_cast<uint8_t>(current);
+	}
+	p_class_count = current + 1;
+}
+
+//########################################################
+// Required literals
+
+Regex::LiteralInfo Regex::p_literals(size_t node) const
+{
+	constexpr size_t MAX_SET = 64;		// a prefilter with more strings than this isn't worth it
+	constexpr size_t MAX_LENGTH = 256;
+	const AstNode &ast = p_ast[node];
+	LiteralInfo info;
+
+	auto score = [](const std::vector<std::string> &set) -> size_t {
+		size_t shortest = set.empty() ? 0 : std::numeric_limits<size_t>::max();
+		for (const auto &s : set)
+			shortest = std::min(shortest, s.size());
+		return shortest;
+	};
+	auto best = [&](const LiteralInfo &child) -> const std::vector<std::string> & {
+		return (child.m_exact_known && score(child.m_exact) >= score(child.m_required)) ? child.m_exact : child.m_required;
+	};
+	auto cross = [&](const std::vector<std::string> &lhs, const std::vector<std::string> &rhs, std::vector<std::string> &out) -> bool {
+		if (lhs.size() * rhs.size() > MAX_SET)
+			return false;
+		out.clear();
+		for (const auto &l : lhs)
+		{
+			for (const auto &r : rhs)
+			{
+				if (l.size() + r.size() > MAX_LENGTH)
+					return false;
+				out.push_back(l + r);
+			}
+		}
+		std::sort(out.begin(), out.end());
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+		return true;
+	};
+
+	switch (ast.m_kind)
+	{
+	case Kind::kind_class:
+	{
+		ByteSet set = ast.m_set;
+		std::vector<std::string> bytes;
+		for (unsigned b = 0; b < 256 && bytes.size() <= 8; b++)
+		{
+			if (set.m_test(b))
+				bytes.push_back(std::string(1, p_nocase ? simd::foldAscii(static_cast<char>(b)) : static_cast<char>(b)));
+		}
+		std::sort(bytes.begin(), bytes.end());
+		bytes.erase(std::unique(bytes.begin(), bytes.end()), bytes.end());
+		if (bytes.size() <= 4 && set.m_count() <= 8)
+		{
+			info.m_exact_known = true;
+			info.m_exact = bytes;
+		}
+		return info;
+	}
+	case Kind::kind_empty:
+	case Kind::kind_bol:
+	case Kind::kind_eol:
+		info.m_exact_known = true;
+		info.m_exact = {""};
+		return info;
+	case Kind::kind_concat:
+	{
+		std::vector<std::string> run = {""}; // exact strings of the current run of exact children
+		bool all_exact = true;
+		auto consider = [&](const std::vector<std::string> &candidate) {
+			if (score(candidate) > score(info.m_required))
+				info.m_required = candidate;
+		};
+		for (size_t child : ast.m_children)
+		{
+			LiteralInfo sub = p_literals(child);
+			consider(sub.m_required);
+			std::vector<std::string> joined;
+			if (sub.m_exact_known && cross(run, sub.m_exact, joined))
+			{
+				run = std::move(joined);
+				continue;
+			}
+			consider(run);
+			if (sub.m_exact_known)
+			{
+				run = sub.m_exact; // too many combinations, start a new run here
+				continue;
+			}
+			all_exact = false;
+			run = {""};
+		}
+		consider(run);
+		if (all_exact)
+		{
+			info.m_exact_known = true;
+			info.m_exact = run;
+		}
+		return info;
+	}
+	case Kind::kind_alternate:
+	{
+		bool all_exact = true;
+		bool all_required = true;
+		for (size_t child : ast.m_children)
+		{
+			LiteralInfo sub = p_literals(child);
+			if (sub.m_exact_known)
+				info.m_exact.insert(info.m_exact.end(), sub.m_exact.begin(), sub.m_exact.end());
+			else
+				all_exact = false;
+
+			const std::vector<std::string> &child_best = best(sub);
+			if (score(child_best) == 0)
+				all_required = false;
+			else
+				info.m_required.insert(info.m_required.end(), child_best.begin(), child_best.end());
+		}
+		std::sort(info.m_exact.begin(), info.m_exact.end());
+		info.m_exact.erase(std::unique(info.m_exact.begin(), info.m_exact.end()), info.m_exact.end());
+		std::sort(info.m_required.begin(), info.m_required.end());
+		info.m_required.erase(std::unique(info.m_required.begin(), info.m_required.end()), info.m_required.end());
+		info.m_exact_known = all_exact && info.m_exact.size() <= MAX_SET;
+		if (!all_required || info.m_required.size() > MAX_SET)
+			info.m_required.clear();
+		return info;
+	}
+	case Kind::kind_repeat:
+	{
+		LiteralInfo sub = p_literals(ast.m_children[0]);
+		if (ast.m_min == 0)
+		{
+			if (ast.m_max == 0)
+			{
+				info.m_exact_known = true;
+				info.m_exact = {""};
+			}
+			return info; // the child may not be there at all
+		}
+		info.m_required = best(sub);
+		if (sub.m_exact_known && ast.m_min == ast.m_max && ast.m_min <= 16)
+		{
+			std::vector<std::string> repeated = {""};
+			bool ok = true;
+			for (int i = 0; i < ast.m_min && ok; i++)
+			{
+				std::vector<std::string> joined;
+				ok = cross(repeated, sub.m_exact, joined);
+				repeated = std::move(joined);
+			}
+			if (ok)
+			{
+				info.m_exact_known = true;
+				info.m_exact = repeated;
+			}
+		}
+		return info;
+	}
+	}
+	return info;
+}
+
+//########################################################
+// Lazy DFA
+
+void Regex::p_closure(uint32_t node, bool bol, std::vector<uint32_t> &set, std::vector<uint8_t> &seen) const
+{
+	std::vector<uint32_t> stack = {node};
+	while (!stack.empty())
+	{
+		const uint32_t current = stack.back();
+		stack.pop_back();
+		if (seen[current])
+			continue;
+		seen[current] = 1;
+
+		const NfaNode &nfa = p_nfa[current];
+		switch (nfa.m_kind)
+		{
+		case NfaKind::nfa_split:
+			stack.push_back(nfa.m_out2);
+			stack.push_back(nfa.m_out);
+			break;
+		case NfaKind::nfa_bol:
+			if (bol)
+				stack.push_back(nfa.m_out);
+			break;
+		case NfaKind::nfa_eol: // waits in the state until the line ends
+		case NfaKind::nfa_class:
+		case NfaKind::nfa_match:
+			set.push_back(current);
+			break;
+		}
+	}
+}
+
+bool Regex::p_matchesAtEol(const std::vector<uint32_t> &nfa, bool bol) const
+{
+	std::vector<uint8_t> seen(p_nfa.size(), 0);
+	std::vector<uint32_t> at_eol;
+	for (uint32_t node : nfa)
+	{
+		if (p_nfa[node].m_kind == NfaKind::nfa_match)
+			return true;
+		if (p_nfa[node].m_kind == NfaKind::nfa_eol)
+			p_closure(p_nfa[node].m_out, bol, at_eol, seen); // what's reachable once the line ended
+	}
+	for (size_t i = 0; i < at_eol.size(); i++)
+	{
+		const NfaNode &node = p_nfa[at_eol[i]];
+		if (node.m_kind == NfaKind::nfa_match)
+			return true;
+		if (node.m_kind == NfaKind::nfa_eol) // $$
+			p_closure(node.m_out, bol, at_eol, seen);
+	}
+	return false;
+}
+
+uint32_t Regex::p_addState(std::vector<uint32_t> &&nfa)
+{
+	std::sort(nfa.begin(), nfa.end());
+	auto it = p_index.find(nfa);
+	if (it != p_index.end())
+		return it->second;
+
+	DfaState state;
+	for (uint32_t node : nfa)
+		state.m_match = state.m_match || p_nfa[node].m_kind == NfaKind::nfa_match;
+	state.m_eol_match = p_matchesAtEol(nfa, false);
+	state.m_nfa = nfa;
+
+	const uint32_t id = static_cast<uint32_t>(p_states.size());
+	p_cache_bytes += sizeof(DfaState) + 2 * nfa.size() * sizeof(uint32_t) + p_class_count * sizeof(uint32_t) + 64;
+	p_index.emplace(std::move(nfa), id);
+	p_states.push_back(std::move(state));
+	p_table.resize(p_table.size() + p_class_count, UNKNOWN);
+	return id;
+}
+
+void Regex::p_resetCache()
+{
+	p_states.clear();
+	p_table.clear();
+	p_index.clear();
+	p_cache_bytes = 0;
+
+	std::vector<uint32_t> start;
+	std::vector<uint8_t> seen(p_nfa.size(), 0);
+	p_closure(p_start, true, start, seen);
+	p_empty_match = p_matchesAtEol(start, true);
+	p_addState(std::move(start)); // always state 0
+}
+
+void Regex::p_flush()
+{
+	p_flushes++;
+	p_resetCache();
+}
+
+uint32_t Regex::p_step(uint32_t state, uint32_t byte_class, uint8_t byte)
+{
+	uint32_t &cached = p_table[static_cast<size_t>(state) * p_class_count + byte_class];
+	if (cached != UNKNOWN)
+		return cached;
+
+	std::vector<uint32_t> next;
+	std::vector<uint8_t> seen(p_nfa.size(), 0);
+	for (uint32_t node : p_states[state].m_nfa)
+	{
+		const NfaNode &nfa = p_nfa[node];
+		if (nfa.m_kind == NfaKind::nfa_class && p_sets[nfa.m_set].m_test(byte))
+			p_closure(nfa.m_out, false, next, seen);
+	}
+
+	if (p_cache_bytes > p_cache_limit)
+	{
+		p_flush(); // "state" is gone after this, the new state doesn't need it
+		return p_addState(std::move(next));
+	}
+	const uint32_t id = p_addState(std::move(next));
+	p_table[static_cast<size_t>(state) * p_class_count + byte_class] = id; // p_table may have moved
+	return id;
+}
+
+bool Regex::m_matchLine(const char *begin, const char *end)
+{
+	if (begin == end)
+		return p_empty_match;
+
+	uint32_t state = 0;
+	if (p_states[state].m_match)
+		return true;
+	for (const char *p = begin; p < end; ++p)
+	{
+		const uint8_t byte = static_cast<uint8_t>(*p);
+		state = p_step(state, p_byte_class[byte], byte);
+		if (p_states[state].m_match)
+			return true;
+	}
+	return p_states[state].m_eol_match;
+}
+
+const char *Regex::m_findLine(const char *begin, const char *end)
+{
+	const char *line = begin;
+	while (line < end)
+	{
+		const char *newline = static_cast<const char *>(std::memchr(line, '\n', static_cast<size_t>(end - line)));
+		const char *line_end = newline != nullptr ? newline : end;
+		if (m_matchLine(line, line_end))
+			return line;
+		line = line_end + 1;
+	}
+	return nullptr;
+}
+
+#endif // regex.hpp
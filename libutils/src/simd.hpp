@@ -0,0 +1,624 @@
+/* Part of https://github.com/HassanIQ777/libutils
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#endif
+
+/* Vectorized byte kernels.
+ * Every kernel has an SSE2, AVX2 and AVX-512BW version, the best one the CPU supports is picked
+ * once at startup (cpuid through __builtin_cpu_supports), so the binary doesn't need -march=native. */
+
+namespace simd
+{
+enum class Level
+{
+	level_scalar,
+	level_sse2,
+	level_avx2,
+	level_avx512
+};
+
+Level detectLevel();				  // best level this CPU (and OS) can run
+Level currentLevel();				  // level the kernels are currently using
+void setLevel(Level level);			  // forces a level (clamped to what the CPU supports), useful for benchmarks
+const char *levelName(Level level); // "scalar", "sse2", "avx2", "avx512"
+
+// returns where "needle" starts in [begin, end), nullptr if it isn't there
+const char *find(const char *begin, const char *end, const char *needle, size_t needle_length);
+
+// same but ignores ASCII case, "needle" has to be folded already (foldAscii) and the haystack is never copied
+const char *findNoCase(const char *begin, const char *end, const char *needle, size_t needle_length);
+
+// how many times "byte" appears in [begin, end), line counting is count(begin, end, '\n')
+size_t count(const char *begin, const char *end, char byte);
+
+// how many control bytes text doesn't have: 0x00-0x1F except \t \n \v \f \r and ESC, plus DEL. For telling binary files apart
+size_t countControl(const char *begin, const char *end);
+
+// how many 2-byte units at even offsets from "begin" equal "unit" (as loaded from memory, so little-endian), for UTF-16 line counting
+size_t countUnits16(const char *begin, const char *end, uint16_t unit);
+
+constexpr char foldAscii(char c) // 'A'-'Z' -> 'a'-'z', every other byte stays the same
+{
+	return (static_cast<unsigned char>(c - 'A') < 26) ? static_cast<char>(c | 0x20) : c;
+}
+std::string foldAscii(std::string_view text);
+
+//########################################################
+// Scalar
+
+namespace detail
+{
+inline const char *find_scalar(const char *begin, const char *end, const char *needle, size_t needle_length)
+{
+	std::string_view haystack(begin, static_cast<size_t>(end - begin));
+	size_t at = haystack.find(std::string_view(needle, needle_length));
+	return at == std::string_view::npos ? nullptr : begin + at;
+}
+
+inline bool equalNoCase(const char *text, const char *folded, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		if (foldAscii(text[i]) != folded[i])
+			return false;
+	}
+	return true;
+}
+
+inline const char *find_nocase_scalar(const char *begin, const char *end, const char *needle, size_t needle_length)
+{
+	if (static_cast<size_t>(end - begin) < needle_length)
+		return nullptr;
+	for (const char *p = begin; p + needle_length <= end; ++p)
+	{
+		if (foldAscii(*p) == needle[0] && equalNoCase(p + 1, needle + 1, needle_length - 1))
+			return p;
+	}
+	return nullptr;
+}
+
+inline size_t count_scalar(const char *begin, const char *end, char byte)
+{
+	size_t total = 0;
+	for (const char *p = begin; p < end; ++p)
+		total += (*p == byte);
+	return total;
+}
+
+constexpr bool isControl(unsigned char c)
+{
+	return c < 0x20 ? (static_cast<unsigned char>(c - '\t') > 4 && c != 0x1B) : c == 0x7F;
+}
+
+inline size_t count_control_scalar(const char *begin, const char *end)
+{
+	size_t total = 0;
+	for (const char *p = begin; p < end; ++p)
+		total += isControl(static_cast<unsigned char>(*p));
+	return total;
+}
+
+inline size_t count_units16_scalar(const char *begin, const char *end, uint16_t unit)
+{
+	size_t total = 0;
+	for (const char *p = begin; end - p >= 2; p += 2)
+	{
+		uint16_t value;
+		std::memcpy(&value, p, 2);
+		total += (value == unit);
+	}
+	return total;
+}
+
+#ifdef SIMD_X86
+/* Compare-then-verify: broadcast the first and the last byte of the needle, compare them against
+ * two loads that are (needle_length - 1) bytes apart, and only memcmp the middle of the positions
+ * where both bytes agree. Needles of length 1 go straight to memchr. */
+
+__attribute__((target("sse2"))) inline const char *find_sse2(const char *begin, const char *end, const char *needle, size_t needle_length)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m128i first = _mm_set1_epi8(needle[0]);
+	const __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+
+	size_t i = 0;
+	for (; i + needle_length - 1 + 16 <= n; i += 16)
+	{
+		const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + i));
+		const __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + i + needle_length - 1));
+		uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+			_mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last))));
+
+		while (mask != 0)
+		{
+			const size_t bit = static_cast<size_t>(__builtin_ctz(mask));
+			if (std::memcmp(begin + i + bit + 1, needle + 1, needle_length - 2) == 0)
+				return begin + i + bit;
+			mask &= mask - 1;
+		}
+	}
+	return find_scalar(begin + i, end, needle, needle_length);
+}
+
+/* Case-insensitive versions fold the haystack blocks in registers: bytes in 'A'-'Z' get 0x20 OR'ed in
+ * ((x - 'A') <= 25 unsigned picks them), everything else is left alone, then the same
+ * first/last byte test runs against the folded needle and candidates are verified in place. */
+
+__attribute__((target("sse2"))) inline __m128i fold_sse2(__m128i x)
+{
+	const __m128i shifted = _mm_sub_epi8(x, _mm_set1_epi8('A'));
+	const __m128i upper = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(25)), shifted);
+	return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+__attribute__((target("sse2"))) inline const char *find_nocase_sse2(const char *begin, const char *end, const char *needle, size_t needle_length)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m128i first = _mm_set1_epi8(needle[0]);
+	const __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+
+	size_t i = 0;
+	for (; i + needle_length - 1 + 16 <= n; i += 16)
+	{
+		const __m128i block_first = fold_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + i)));
+		const __m128i block_last = fold_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + i + needle_length - 1)));
+		uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+			_mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last))));
+
+		while (mask != 0)
+		{
+			const size_t bit = static_cast<size_t>(__builtin_ctz(mask));
+			if (equalNoCase(begin + i + bit + 1, needle + 1, needle_length - 1))
+				return begin + i + bit;
+			mask &= mask - 1;
+		}
+	}
+	return find_nocase_scalar(begin + i, end, needle, needle_length);
+}
+
+__attribute__((target("avx2"))) inline const char *find_avx2(const char *begin, const char *end, const char *needle, size_t needle_length)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m256i first = _mm256_set1_epi8(needle[0]);
+	const __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+
+	size_t i = 0;
+	for (; i + needle_length - 1 + 32 <= n; i += 32)
+	{
+		const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + i));
+		const __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + i + needle_length - 1));
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+			_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last))));
+
+		while (mask != 0)
+		{
+			const size_t bit = static_cast<size_t>(__builtin_ctz(mask));
+			if (std::memcmp(begin + i + bit + 1, needle + 1, needle_length - 2) == 0)
+				return begin + i + bit;
+			mask &= mask - 1;
+		}
+	}
+	return find_sse2(begin + i, end, needle, needle_length);
+}
+
+__attribute__((target("avx2"))) inline __m256i fold_avx2(__m256i x)
+{
+	const __m256i shifted = _mm256_sub_epi8(x, _mm256_set1_epi8('A'));
+	const __m256i upper = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(25)), shifted);
+	return _mm256_or_si256(x, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2"))) inline const char *find_nocase_avx2(const char *begin, const char *end, const char *needle, size_t needle_length)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m256i first = _mm256_set1_epi8(needle[0]);
+	const __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+
+	size_t i = 0;
+	for (; i + needle_length - 1 + 32 <= n; i += 32)
+	{
+		const __m256i block_first = fold_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + i)));
+		const __m256i block_last = fold_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + i + needle_length - 1)));
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+			_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last))));
+
+		while (mask != 0)
+		{
+			const size_t bit = static_cast<size_t>(__builtin_ctz(mask));
+			if (equalNoCase(begin + i + bit + 1, needle + 1, needle_length - 1))
+				return begin + i + bit;
+			mask &= mask - 1;
+		}
+	}
+	return find_nocase_sse2(begin + i, end, needle, needle_length);
+}
+
+__attribute__((target("avx512f,avx512bw"))) inline const char *find_avx512(const char *begin, const char *end, const char *needle, size_t needle_length)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m512i first = _mm512_set1_epi8(needle[0]);
+	const __m512i last = _mm512_set1_epi8(needle[needle_length - 1]);
+
+	size_t i = 0;
+	for (; i + needle_length - 1 + 64 <= n; i += 64)
+	{
+		const __m512i block_first = _mm512_loadu_si512(begin + i);
+		const __m512i block_last = _mm512_loadu_si512(begin + i + needle_length - 1);
+		uint64_t mask = _mm512_cmpeq_epi8_mask(first, block_first) & _mm512_cmpeq_epi8_mask(last, block_last);
+
+		while (mask != 0)
+		{
+			const size_t bit = static_cast<size_t>(__builtin_ctzll(mask));
+			if (std::memcmp(begin + i + bit + 1, needle + 1, needle_length - 2) == 0)
+				return begin + i + bit;
+			mask &= mask - 1;
+		}
+	}
+	return find_avx2(begin + i, end, needle, needle_length);
+}
+
+__attribute__((target("avx512f,avx512bw"))) inline __m512i fold_avx512(__m512i x)
+{
+	const __mmask64 upper = _mm512_cmple_epu8_mask(_mm512_sub_epi8(x, _mm512_set1_epi8('A')), _mm512_set1_epi8(25));
+	return _mm512_mask_blend_epi8(upper, x, _mm512_or_si512(x, _mm512_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx512f,avx512bw"))) inline const char *find_nocase_avx512(const char *begin, const char *end, const char *needle, size_t needle_length)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m512i first = _mm512_set1_epi8(needle[0]);
+	const __m512i last = _mm512_set1_epi8(needle[needle_length - 1]);
+
+	size_t i = 0;
+	for (; i + needle_length - 1 + 64 <= n; i += 64)
+	{
+		const __m512i block_first = fold_avx512(_mm512_loadu_si512(begin + i));
+		const __m512i block_last = fold_avx512(_mm512_loadu_si512(begin + i + needle_length - 1));
+		uint64_t mask = _mm512_cmpeq_epi8_mask(first, block_first) & _mm512_cmpeq_epi8_mask(last, block_last);
+
+		while (mask != 0)
+		{
+			const size_t bit = static_cast<size_t>(__builtin_ctzll(mask));
+			if (equalNoCase(begin + i + bit + 1, needle + 1, needle_length - 1))
+				return begin + i + bit;
+			mask &= mask - 1;
+		}
+	}
+	return find_nocase_avx2(begin + i, end, needle, needle_length);
+}
+
+/* Counting: SSE2 has no popcnt to rely on, so the 0xFF compare results are subtracted into byte
+ * counters (at most 255 rounds so they can't wrap) and psadbw adds the counters up.
+ * AVX2 and AVX-512 popcount the compare masks directly. */
+
+__attribute__((target("sse2"))) inline size_t count_sse2(const char *begin, const char *end, char byte)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m128i target = _mm_set1_epi8(byte);
+	const __m128i zero = _mm_setzero_si128();
+	size_t total = 0;
+	size_t i = 0;
+	while (i + 16 <= n)
+	{
+		const size_t rounds = std::min<size_t>((n - i) / 16, 255);
+		__m128i counters = zero;
+		for (size_t r = 0; r < rounds; r++, i += 16)
+			counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + i)), target));
+		const __m128i sums = _mm_sad_epu8(counters, zero);
+		total += static_cast<size_t>(_mm_cvtsi128_si64(sums)) + static_cast<size_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums)));
+	}
+	return total + count_scalar(begin + i, end, byte);
+}
+
+__attribute__((target("avx2,popcnt"))) inline size_t count_avx2(const char *begin, const char *end, char byte)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m256i target = _mm256_set1_epi8(byte);
+	size_t total = 0;
+	size_t i = 0;
+	for (; i + 64 <= n; i += 64)
+	{
+		const uint32_t low = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + i)), target)));
+		const uint32_t high = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + i + 32)), target)));
+		total += static_cast<size_t>(_mm_popcnt_u64((static_cast<uint64_t>(high) << 32) | low));
+	}
+	return total + count_sse2(begin + i, end, byte);
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt"))) inline size_t count_avx512(const char *begin, const char *end, char byte)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m512i target = _mm512_set1_epi8(byte);
+	size_t total = 0;
+	size_t i = 0;
+	for (; i + 128 <= n; i += 128)
+	{
+		total += static_cast<size_t>(_mm_popcnt_u64(_mm512_cmpeq_epi8_mask(_mm512_loadu_si512(begin + i), target)));
+		total += static_cast<size_t>(_mm_popcnt_u64(_mm512_cmpeq_epi8_mask(_mm512_loadu_si512(begin + i + 64), target)));
+	}
+	if (i < n) // the tail goes through one masked load, no scalar loop
+	{
+		const size_t left = n - i;
+		const __mmask64 first = (left >= 64) ? ~__mmask64(0) : (__mmask64(1) << left) - 1;
+		total += static_cast<size_t>(_mm_popcnt_u64(_mm512_mask_cmpeq_epi8_mask(first, _mm512_maskz_loadu_epi8(first, begin + i), target)));
+		if (left > 64)
+		{
+			const __mmask64 second = (__mmask64(1) << (left - 64)) - 1;
+			total += static_cast<size_t>(_mm_popcnt_u64(_mm512_mask_cmpeq_epi8_mask(second, _mm512_maskz_loadu_epi8(second, begin + i + 64), target)));
+		}
+	}
+	return total;
+}
+/* Control bytes: x <= 0x1F and not (x - 9) <= 4 (\t..\r) and not ESC, or DEL.
+ * Unsigned <= is min_epu8(x, limit) == x before AVX-512, which has real unsigned compares. */
+
+__attribute__((target("sse2"))) inline __m128i control_sse2(__m128i x)
+{
+	const __m128i low = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(0x1F)), x);
+	const __m128i shifted = _mm_sub_epi8(x, _mm_set1_epi8('\t'));
+	const __m128i space = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted), _mm_cmpeq_epi8(x, _mm_set1_epi8(0x1B)));
+	return _mm_or_si128(_mm_andnot_si128(space, low), _mm_cmpeq_epi8(x, _mm_set1_epi8(0x7F)));
+}
+
+__attribute__((target("sse2"))) inline size_t count_control_sse2(const char *begin, const char *end)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m128i zero = _mm_setzero_si128();
+	size_t total = 0;
+	size_t i = 0;
+	while (i + 16 <= n) // same byte counters as count_sse2
+	{
+		const size_t rounds = std::min<size_t>((n - i) / 16, 255);
+		__m128i counters = zero;
+		for (size_t r = 0; r < rounds; r++, i += 16)
+			counters = _mm_sub_epi8(counters, control_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + i))));
+		const __m128i sums = _mm_sad_epu8(counters, zero);
+		total += static_cast<size_t>(_mm_cvtsi128_si64(sums)) + static_cast<size_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums)));
+	}
+	return total + count_control_scalar(begin + i, end);
+}
+
+__attribute__((target("avx2,popcnt"))) inline size_t count_control_avx2(const char *begin, const char *end)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m256i limit = _mm256_set1_epi8(0x1F);
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i four = _mm256_set1_epi8(4);
+	const __m256i escape = _mm256_set1_epi8(0x1B);
+	const __m256i del = _mm256_set1_epi8(0x7F);
+	size_t total = 0;
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32)
+	{
+		const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + i));
+		const __m256i low = _mm256_cmpeq_epi8(_mm256_min_epu8(x, limit), x);
+		const __m256i shifted = _mm256_sub_epi8(x, tab);
+		const __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(shifted, four), shifted), _mm256_cmpeq_epi8(x, escape));
+		const __m256i control = _mm256_or_si256(_mm256_andnot_si256(space, low), _mm256_cmpeq_epi8(x, del));
+		total += static_cast<size_t>(_mm_popcnt_u32(static_cast<uint32_t>(_mm256_movemask_epi8(control))));
+	}
+	return total + count_control_sse2(begin + i, end);
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt"))) inline size_t count_control_avx512(const char *begin, const char *end)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m512i limit = _mm512_set1_epi8(0x1F);
+	const __m512i tab = _mm512_set1_epi8('\t');
+	const __m512i four = _mm512_set1_epi8(4);
+	const __m512i escape = _mm512_set1_epi8(0x1B);
+	const __m512i del = _mm512_set1_epi8(0x7F);
+	size_t total = 0;
+	for (size_t i = 0; i < n; i += 64)
+	{
+		const __mmask64 valid = (n - i >= 64) ? ~__mmask64(0) : (__mmask64(1) << (n - i)) - 1;
+		const __m512i x = _mm512_maskz_loadu_epi8(valid, begin + i);
+		const __mmask64 space = _mm512_cmple_epu8_mask(_mm512_sub_epi8(x, tab), four) | _mm512_cmpeq_epi8_mask(x, escape);
+		const __mmask64 control = (_mm512_cmple_epu8_mask(x, limit) & ~space) | _mm512_cmpeq_epi8_mask(x, del);
+		total += static_cast<size_t>(_mm_popcnt_u64(control & valid));
+	}
+	return total;
+}
+
+/* UTF-16 units: the same counting with 16-bit compares, a matching unit sets 2 bits of a byte movemask */
+
+__attribute__((target("sse2"))) inline size_t count_units16_sse2(const char *begin, const char *end, uint16_t unit)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m128i target = _mm_set1_epi16(static_cast<short>(unit));
+	const __m128i ones = _mm_set1_epi16(1);
+	size_t total = 0;
+	size_t i = 0;
+	while (i + 16 <= n)
+	{
+		const size_t rounds = std::min<size_t>((n - i) / 16, 32767); // pmaddwd reads the counters as signed
+		__m128i counters = _mm_setzero_si128();
+		for (size_t r = 0; r < rounds; r++, i += 16)
+			counters = _mm_sub_epi16(counters, _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + i)), target));
+		__m128i sums = _mm_madd_epi16(counters, ones);
+		sums = _mm_add_epi32(sums, _mm_unpackhi_epi64(sums, sums));
+		sums = _mm_add_epi32(sums, _mm_srli_epi64(sums, 32));
+		total += static_cast<uint32_t>(_mm_cvtsi128_si32(sums));
+	}
+	return total + count_units16_scalar(begin + i, end, unit);
+}
+
+__attribute__((target("avx2,popcnt"))) inline size_t count_units16_avx2(const char *begin, const char *end, uint16_t unit)
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m256i target = _mm256_set1_epi16(static_cast<short>(unit));
+	size_t total = 0;
+	size_t i = 0;
+	for (; i + 64 <= n; i += 64)
+	{
+		const uint32_t low = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + i)), target)));
+		const uint32_t high = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + i + 32)), target)));
+		total += static_cast<size_t>(_mm_popcnt_u64((static_cast<uint64_t>(high) << 32) | low)) / 2;
+	}
+	return total + count_units16_sse2(begin + i, end, unit);
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt"))) inline size_t count_units16_avx512(const char *begin, const char *end, uint16_t unit)
+{
+	const size_t n = static_cast<size_t>(end - begin) / 2; // in units, an odd byte at the end isn't one
+	const __m512i target = _mm512_set1_epi16(static_cast<short>(unit));
+	size_t total = 0;
+	for (size_t i = 0; i < n; i += 32)
+	{
+		const __mmask32 valid = (n - i >= 32) ? ~__mmask32(0) : (__mmask32(1) << (n - i)) - 1;
+		const __m512i x = _mm512_maskz_loadu_epi16(valid, begin + 2 * i);
+		total += static_cast<size_t>(_mm_popcnt_u32(_mm512_mask_cmpeq_epi16_mask(valid, x, target)));
+	}
+	return total;
+}
+#endif // SIMD_X86
+
+using find_fn = const char *(*)(const char *, const char *, const char *, size_t);
+using count_fn = size_t (*)(const char *, const char *, char);
+using count_control_fn = size_t (*)(const char *, const char *);
+using count_units16_fn = size_t (*)(const char *, const char *, uint16_t);
+
+struct Kernels
+{
+	Level m_level;
+	find_fn m_find;
+	find_fn m_find_nocase;
+	count_fn m_count;
+	count_control_fn m_count_control;
+	count_units16_fn m_count_units16;
+};
+
+inline Kernels kernelsFor(Level level)
+{
+#ifdef SIMD_X86
+	switch (level)
+	{
+	case Level::level_avx512:
+		return {level, find_avx512, find_nocase_avx512, count_avx512, count_control_avx512, count_units16_avx512};
+	case Level::level_avx2:
+		return {level, find_avx2, find_nocase_avx2, count_avx2, count_control_avx2, count_units16_avx2};
+	case Level::level_sse2:
+		return {level, find_sse2, find_nocase_sse2, count_sse2, count_control_sse2, count_units16_sse2};
+	default:
+		break;
+	}
+#endif
+	return {Level::level_scalar, find_scalar, find_nocase_scalar, count_scalar, count_control_scalar, count_units16_scalar};
+}
+
+inline Kernels &activeKernels()
+{
+	static Kernels kernels = kernelsFor(detectLevel());
+	return kernels;
+}
+} // namespace detail
+
+//########################################################
+// Dispatch
+
+inline Level detectLevel()
+{
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512bw"))
+		return Level::level_avx512;
+	if (__builtin_cpu_supports("avx2"))
+		return Level::level_avx2;
+	return Level::level_sse2; // every x86-64 has it
+#else
+	return Level::level_scalar;
+#endif
+}
+
+inline Level currentLevel()
+{
+	return detail::activeKernels().m_level;
+}
+
+inline void setLevel(Level level)
+{
+	if (static_cast<int>(level) > static_cast<int>(detectLevel()))
+		level = detectLevel();
+	detail::activeKernels() = detail::kernelsFor(level);
+}
+
+inline const char *levelName(Level level)
+{
+	switch (level)
+	{
+	case Level::level_avx512:
+		return "avx512";
+	case Level::level_avx2:
+		return "avx2";
+	case Level::level_sse2:
+		return "sse2";
+	default:
+		return "scalar";
+	}
+}
+
+inline const char *find(const char *begin, const char *end, const char *needle, size_t needle_length)
+{
+	if (needle_length == 0)
+		return begin;
+	if (static_cast<size_t>(end - begin) < needle_length)
+		return nullptr;
+	if (needle_length == 1)
+		return static_cast<const char *>(std::memchr(begin, needle[0], static_cast<size_t>(end - begin)));
+	return detail::activeKernels().m_find(begin, end, needle, needle_length);
+}
+
+inline const char *findNoCase(const char *begin, const char *end, const char *needle, size_t needle_length)
+{
+	if (needle_length == 0)
+		return begin;
+	if (static_cast<size_t>(end - begin) < needle_length)
+		return nullptr;
+	return detail::activeKernels().m_find_nocase(begin, end, needle, needle_length);
+}
+
+inline size_t count(const char *begin, const char *end, char byte)
+{
+	if (begin >= end)
+		return 0;
+	return detail::activeKernels().m_count(begin, end, byte);
+}
+
+inline size_t countControl(const char *begin, const char *end)
+{
+	if (begin >= end)
+		return 0;
+	return detail::activeKernels().m_count_control(begin, end);
+}
+
+inline size_t countUnits16(const char *begin, const char *end, uint16_t unit)
+{
+	if (end - begin < 2)
+		return 0;
+	return detail::activeKernels().m_count_units16(begin, end, unit);
+}
+
+inline std::string foldAscii(std::string_view text)
+{
+	std::string folded(text);
+	for (char &c : folded)
+		c = foldAscii(c);
+	return folded;
+}
+} // namespace simd
+
+#endif // simd.hpp
@@ -0,0 +1,241 @@
+/* Part of https://github.com/HassanIQ777/libutils
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef SUFFIXARRAY_HPP
+#define SUFFIXARRAY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+/* EXAMPLE: */
+/*
+std::string text = "banana";
+auto sa = suffixarray::build<uint32_t>(reinterpret_cast<const uint8_t *>(text.data()), text.size()); // 5 3 1 0 4 2
+auto lcp = suffixarray::buildLcp(reinterpret_cast<const uint8_t *>(text.data()), text.size(), sa);	  // 0 1 3 0 0 2
+auto [first, last] = suffixarray::equalRange(text, sa, "an");									  // sa[first..last) = 3 1
+*/
+
+/* Suffix arrays built with SA-IS (Nong, Zhang & Chan), linear time, no sentinel needed at the end of the text.
+ * Index is the integer type of the array, uint32_t for texts under 4GB halves the memory of uint64_t.
+ * Building takes the array plus about as much again for the LMS bookkeeping. */
+
+namespace suffixarray
+{
+namespace detail
+{
+template <typename Index>
+constexpr Index NONE = std::numeric_limits<Index>::max();
+
+// s[0..n) with symbols in [0, upper]
+template <typename Index, typename Symbol>
+std::vector<Index> sais(const Symbol *s, Index n, Index upper)
+{
+	if (n < 8) // not worth the machinery
+	{
+		std::vector<Index> sa(n);
+		for (Index i = 0; i < n; i++)
+			sa[i] = i;
+		std::sort(sa.begin(), sa.end(), [&](Index a, Index b) {
+			return std::lexicographical_compare(s + a, s + n, s + b, s + n);
+		});
+		return sa;
+	}
+
+	// ls[i]: suffix i is S type (smaller than suffix i + 1), the last one is L against the virtual sentinel
+	std::vector<bool> ls(n, false);
+	for (Index i = n - 1; i-- > 0;)
+		ls[i] = (s[i] == s[i + 1]) ? ls[i + 1] : (s[i] < s[i + 1]);
+
+	// bucket starts: sum_l[c] for the L suffixes starting with c, sum_s[c] for the S ones
+	std::vector<Index> sum_l(static_cast<size_t>(upper) + 2, 0), sum_s(static_cast<size_t>(upper) + 2, 0);
+	for (Index i = 0; i < n; i++)
+	{
+		if (!ls[i])
+			sum_s[s[i]]++;
+		else
+			sum_l[static_cast<size_t>(s[i]) + 1]++;
+	}
+	for (size_t c = 0; c <= upper; c++)
+	{
+		sum_s[c] += sum_l[c];
+		sum_l[c + 1] += sum_s[c];
+	}
+
+	std::vector<Index> sa(n);
+	std::vector<Index> buckets(static_cast<size_t>(upper) + 2);
+	auto induce = [&](const std::vector<Index> &lms) {
+		std::fill(sa.begin(), sa.end(), NONE<Index>);
+		std::copy(sum_s.begin(), sum_s.end(), buckets.begin());
+		for (Index d : lms)
+			sa[buckets[s[d]]++] = d;
+		std::copy(sum_l.begin(), sum_l.end(), buckets.begin());
+		sa[buckets[s[n - 1]]++] = n - 1;
+		for (Index i = 0; i < n; i++)
+		{
+			const Index v = sa[i];
+			if (v != NONE<Index> && v >= 1 && !ls[v - 1])
+				sa[buckets[s[v - 1]]++] = v - 1;
+		}
+		std::copy(sum_l.begin(), sum_l.end(), buckets.begin());
+		for (Index i = n; i-- > 0;)
+		{
+			const Index v = sa[i];
+			if (v != NONE<Index> && v >= 1 && ls[v - 1])
+				sa[--buckets[static_cast<size_t>(s[v - 1]) + 1]] = v - 1;
+		}
+	};
+
+	// LMS positions: S type right after an L type
+	std::vector<Index> lms_map(static_cast<size_t>(n) + 1, NONE<Index>);
+	std::vector<Index> lms;
+	for (Index i = 1; i < n; i++)
+	{
+		if (!ls[i - 1] && ls[i])
+		{
+			lms_map[i] = static_cast<Index>(lms.size());
+			lms.push_back(i);
+		}
+	}
+	const Index m = static_cast<Index>(lms.size());
+
+	induce(lms);
+	if (m == 0)
+		return sa;
+
+	// name the sorted LMS substrings, equal neighbours get the same name
+	std::vector<Index> sorted_lms;
+	sorted_lms.reserve(m);
+	for (Index v : sa)
+	{
+		if (lms_map[v] != NONE<Index>)
+			sorted_lms.push_back(v);
+	}
+	std::vector<Index> reduced(m);
+	Index names = 0;
+	reduced[lms_map[sorted_lms[0]]] = 0;
+	for (Index i = 1; i < m; i++)
+	{
+		Index l = sorted_lms[i - 1], r = sorted_lms[i];
+		const Index end_l = (lms_map[l] + 1 < m) ? lms[lms_map[l] + 1] : n;
+		const Index end_r = (lms_map[r] + 1 < m) ? lms[lms_map[r] + 1] : n;
+		bool same = end_l - l == end_r - r;
+		if (same)
+		{
+			while (l < end_l && s[l] == s[r])
+				l++, r++;
+			if (l == n || s[l] != s[r])
+				same = false;
+		}
+		if (!same)
+			names++;
+		reduced[lms_map[sorted_lms[i]]] = names;
+	}
+	lms_map = {};
+
+	// all names different: the order is known, otherwise recurse on the names
+	std::vector<Index> reduced_sa = sais<Index, Index>(reduced.data(), m, names);
+	for (Index i = 0; i < m; i++)
+		sorted_lms[i] = lms[reduced_sa[i]];
+	induce(sorted_lms);
+	return sa;
+}
+} // namespace detail
+
+template <typename Index>
+std::vector<Index> build(const uint8_t *text, size_t length)
+{
+	if (length >= std::numeric_limits<Index>::max())
+		return {}; // doesn't fit the index type, NONE has to stay free
+	return detail::sais<Index, uint8_t>(text, static_cast<Index>(length), Index(255));
+}
+
+/* Kasai's LCP array: lcp[i] = length of the common prefix of suffixes sa[i - 1] and sa[i], lcp[0] = 0.
+ * Saturated at 255 so it costs a byte per suffix, that's plenty to tell a match run apart */
+template <typename Index>
+std::vector<uint8_t> buildLcp(const uint8_t *text, size_t length, const std::vector<Index> &sa)
+{
+	std::vector<uint8_t> lcp(length, 0);
+	std::vector<Index> rank(length);
+	for (size_t i = 0; i < length; i++)
+		rank[sa[i]] = static_cast<Index>(i);
+
+	size_t h = 0;
+	for (size_t i = 0; i < length; i++)
+	{
+		if (rank[i] == 0)
+		{
+			h = 0;
+			continue;
+		}
+		const size_t j = sa[rank[i] - 1];
+		while (i + h < length && j + h < length && text[i + h] == text[j + h])
+			h++;
+		lcp[rank[i]] = static_cast<uint8_t>(std::min<size_t>(h, 255));
+		if (h > 0)
+			h--;
+	}
+	return lcp;
+}
+
+namespace detail
+{
+// <0 / 0 / >0: the suffix at "position" is before / starts with / is after the pattern
+inline int comparePrefix(std::string_view text, size_t position, std::string_view pattern)
+{
+	const size_t length = std::min(pattern.size(), text.size() - position);
+	const int result = std::memcmp(text.data() + position, pattern.data(), length);
+	if (result != 0)
+		return result;
+	return length < pattern.size() ? -1 : 0;
+}
+} // namespace detail
+
+// first i with sa[i] starting with "pattern" or after it
+template <typename Array>
+size_t lowerBound(std::string_view text, const Array &sa, std::string_view pattern, size_t low = 0)
+{
+	size_t high = sa.size();
+	while (low < high)
+	{
+		const size_t middle = low + (high - low) / 2;
+		if (detail::comparePrefix(text, sa[middle], pattern) < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+// first i with sa[i] after every suffix that starts with "pattern"
+template <typename Array>
+size_t upperBound(std::string_view text, const Array &sa, std::string_view pattern, size_t low = 0)
+{
+	size_t high = sa.size();
+	while (low < high)
+	{
+		const size_t middle = low + (high - low) / 2;
+		if (detail::comparePrefix(text, sa[middle], pattern) <= 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+// The run sa[first..last) of suffixes starting with "pattern"
+template <typename Array>
+std::pair<size_t, size_t> equalRange(std::string_view text, const Array &sa, std::string_view pattern)
+{
+	const size_t first = lowerBound(text, sa, pattern);
+	return {first, upperBound(text, sa, pattern, first)};
+}
+} // namespace suffixarray
+
+#endif // suffixarray.hpp
@@ -0,0 +1,255 @@
+/* Part of https://github.com/HassanIQ777/libutils
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef TEDDY_HPP
+#define TEDDY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+#include "simd.hpp"
+
+/* EXAMPLE: */
+/*
+Teddy teddy;
+if (teddy.m_build({"ERROR", "FATAL", "panic", "OOMKilled"}))
+	const char *at = teddy.m_find(begin, end);
+*/
+
+/* Small-set multi-literal search (the "Teddy" idea from Hyperscan):
+ * the patterns are spread over 8 buckets, and for each of the first 1-3 bytes of a pattern
+ * (the fingerprint) two 16 entry nibble tables say which buckets have that low/high nibble there.
+ * One pshufb per nibble per fingerprint byte checks 16 (SSSE3) or 32 (AVX2) positions against
+ * every pattern at once, only the positions that survive get memcmp'd against their bucket.
+ * Needs SSSE3, m_build() returns false when the CPU (or the pattern set) can't use it. */
+
+class Teddy
+{
+  public:
+	static constexpr size_t MAX_PATTERNS = 64;
+	static constexpr size_t BUCKETS = 8;
+	static constexpr size_t MAX_FINGERPRINT = 3;
+
+	static bool m_supported(); // does this CPU have what Teddy needs
+
+	bool m_build(const std::vector<std::string> &patterns, bool case_insensitive = false); // false if there are too many patterns, an empty one, or no SSSE3
+
+	const char *m_find(const char *begin, const char *end) const; // start of the leftmost match in [begin, end), nullptr if none
+
+	const std::string &m_pattern(size_t id) const { return p_patterns[id]; }
+	size_t m_patternCount() const { return p_patterns.size(); }
+
+  private:
+	std::vector<std::string> p_patterns;			// sorted, similar prefixes end up in the same bucket
+	std::vector<uint8_t> p_bucket_patterns[BUCKETS]; // pattern ids per bucket
+	size_t p_fingerprint = 1;
+	alignas(16) uint8_t p_lo[MAX_FINGERPRINT][16] = {};
+	alignas(16) uint8_t p_hi[MAX_FINGERPRINT][16] = {};
+	bool p_avx2 = false;
+	bool p_nocase = false; // patterns are stored folded and candidates are verified with folding
+
+	const char *p_verify(const char *at, const char *end, uint8_t buckets) const
+	{
+		while (buckets != 0)
+		{
+			const unsigned bucket = static_cast<unsigned>(__builtin_ctz(buckets));
+			buckets = static_cast<uint8_t>(buckets & (buckets - 1));
+			for (uint8_t id : p_bucket_patterns[bucket])
+			{
+				const std::string &pattern = p_patterns[id];
+				if (static_cast<size_t>(end - at) < pattern.size())
+					continue;
+				if (p_nocase ? simd::detail::equalNoCase(at, pattern.data(), pattern.size())
+							 : std::memcmp(at, pattern.data(), pattern.size()) == 0)
+					return at;
+			}
+		}
+		return nullptr;
+	}
+
+	uint8_t p_scalarBuckets(const char *at) const // same bucket test as the vector code, for the tail
+	{
+		uint8_t buckets = 0xFF;
+		for (size_t k = 0; k < p_fingerprint; k++)
+		{
+			const uint8_t byte = static_cast<uint8_t>(at[k]);
+			buckets &= p_lo[k][byte & 0x0F] & p_hi[k][byte >> 4];
+		}
+		return buckets;
+	}
+
+	const char *p_findTail(const char *p, const char *end) const
+	{
+		// every pattern is at least p_fingerprint long, so nothing can start closer to the end than that
+		for (; static_cast<size_t>(end - p) >= p_fingerprint; ++p)
+		{
+			const uint8_t buckets = p_scalarBuckets(p);
+			if (buckets == 0)
+				continue;
+			if (const char *found = p_verify(p, end, buckets))
+				return found;
+		}
+		return nullptr;
+	}
+
+#ifdef SIMD_X86
+	__attribute__((target("ssse3"))) const char *p_findSSSE3(const char *begin, const char *end) const;
+	__attribute__((target("avx2"))) const char *p_findAVX2(const char *begin, const char *end) const;
+#endif
+};
+
+bool Teddy::m_supported()
+{
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("ssse3");
+#else
+	return false;
+#endif
+}
+
+bool Teddy::m_build(const std::vector<std::string> &patterns, bool case_insensitive)
+{
+	if (!m_supported() || patterns.empty() || patterns.size() > MAX_PATTERNS)
+		return false;
+
+	p_nocase = case_insensitive;
+	p_patterns.clear();
+	for (const auto &pattern : patterns)
+		p_patterns.push_back(case_insensitive ? simd::foldAscii(pattern) : pattern);
+	std::sort(p_patterns.begin(), p_patterns.end());
+	p_patterns.erase(std::unique(p_patterns.begin(), p_patterns.end()), p_patterns.end());
+	if (p_patterns.front().empty())
+		return false;
+
+	p_fingerprint = MAX_FINGERPRINT;
+	for (const auto &pattern : p_patterns)
+		p_fingerprint = std::min(p_fingerprint, pattern.size());
+
+	std::memset(p_lo, 0, sizeof(p_lo));
+	std::memset(p_hi, 0, sizeof(p_hi));
+	for (auto &bucket : p_bucket_patterns)
+		bucket.clear();
+
+	for (size_t id = 0; id < p_patterns.size(); id++)
+	{
+		const size_t bucket = id * BUCKETS / p_patterns.size();
+		const uint8_t bit = static_cast<uint8_t>(1u << bucket);
+		p_bucket_patterns[bucket].push_back(static_cast<uint8_t>(id));
+		for (size_t k = 0; k < p_fingerprint; k++)
+		{
+			const uint8_t byte = static_cast<uint8_t>(p_patterns[id][k]);
+			p_lo[k][byte & 0x0F] |= bit;
+			p_hi[k][byte >> 4] |= bit;
+			if (case_insensitive && byte >= 'a' && byte <= 'z') // the uppercase letter goes in the same bucket
+			{
+				const uint8_t upper = static_cast<uint8_t>(byte & ~0x20);
+				p_lo[k][upper & 0x0F] |= bit;
+				p_hi[k][upper >> 4] |= bit;
+			}
+		}
+	}
+
+	p_avx2 = static_cast<int>(simd::currentLevel()) >= static_cast<int>(simd::Level::level_avx2);
+	return true;
+}
+
+const char *Teddy::m_find(const char *begin, const char *end) const
+{
+#ifdef SIMD_X86
+	return p_avx2 ? p_findAVX2(begin, end) : p_findSSSE3(begin, end);
+#else
+	return p_findTail(begin, end);
+#endif
+}
+
+#ifdef SIMD_X86
+const char *Teddy::p_findSSSE3(const char *begin, const char *end) const
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m128i nibble = _mm_set1_epi8(0x0F);
+	__m128i lo[MAX_FINGERPRINT], hi[MAX_FINGERPRINT];
+	for (size_t k = 0; k < p_fingerprint; k++)
+	{
+		lo[k] = _mm_load_si128(reinterpret_cast<const __m128i *>(p_lo[k]));
+		hi[k] = _mm_load_si128(reinterpret_cast<const __m128i *>(p_hi[k]));
+	}
+
+	size_t i = 0;
+	for (; i + 16 + p_fingerprint - 1 <= n; i += 16)
+	{
+		__m128i buckets = _mm_set1_epi8(static_cast<char>(0xFF));
+		for (size_t k = 0; k < p_fingerprint; k++)
+		{
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + i + k));
+			const __m128i low = _mm_and_si128(chunk, nibble);
+			const __m128i high = _mm_and_si128(_mm_srli_epi16(chunk, 4), nibble);
+			buckets = _mm_and_si128(buckets, _mm_and_si128(_mm_shuffle_epi8(lo[k], low), _mm_shuffle_epi8(hi[k], high)));
+		}
+
+		uint32_t candidates = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(buckets, _mm_setzero_si128()))) & 0xFFFFu;
+		if (candidates == 0)
+			continue;
+
+		alignas(16) uint8_t lanes[16];
+		_mm_store_si128(reinterpret_cast<__m128i *>(lanes), buckets);
+		while (candidates != 0)
+		{
+			const size_t j = static_cast<size_t>(__builtin_ctz(candidates));
+			if (const char *found = p_verify(begin + i + j, end, lanes[j]))
+				return found;
+			candidates &= candidates - 1;
+		}
+	}
+	return p_findTail(begin + i, end);
+}
+
+const char *Teddy::p_findAVX2(const char *begin, const char *end) const
+{
+	const size_t n = static_cast<size_t>(end - begin);
+	const __m256i nibble = _mm256_set1_epi8(0x0F);
+	__m256i lo[MAX_FINGERPRINT], hi[MAX_FINGERPRINT];
+	for (size_t k = 0; k < p_fingerprint; k++)
+	{
+		// vpshufb works per 128 bit lane, so both lanes get the same table
+		lo[k] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(p_lo[k])));
+		hi[k] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(p_hi[k])));
+	}
+
+	size_t i = 0;
+	for (; i + 32 + p_fingerprint - 1 <= n; i += 32)
+	{
+		__m256i buckets = _mm256_set1_epi8(static_cast<char>(0xFF));
+		for (size_t k = 0; k < p_fingerprint; k++)
+		{
+			const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin + i + k));
+			const __m256i low = _mm256_and_si256(chunk, nibble);
+			const __m256i high = _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble);
+			buckets = _mm256_and_si256(buckets, _mm256_and_si256(_mm256_shuffle_epi8(lo[k], low), _mm256_shuffle_epi8(hi[k], high)));
+		}
+
+		uint32_t candidates = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(buckets, _mm256_setzero_si256())));
+		if (candidates == 0)
+			continue;
+
+		alignas(32) uint8_t lanes[32];
+		_mm256_store_si256(reinterpret_cast<__m256i *>(lanes), buckets);
+		while (candidates != 0)
+		{
+			const size_t j = static_cast<size_t>(__builtin_ctz(candidates));
+			if (const char *found = p_verify(begin + i + j, end, lanes[j]))
+				return found;
+			candidates &= candidates - 1;
+		}
+	}
+	return p_findSSSE3(begin + i, end);
+}
+#endif // SIMD_X86
+
+#endif // teddy.hpp
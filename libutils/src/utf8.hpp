@@ -0,0 +1,345 @@
+/* Part of https://github.com/HassanIQ777/libutils
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef UTF8_HPP
+#define UTF8_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "simd.hpp"
+
+/* EXAMPLE: */
+/*
+utf8::isValid(text.data(), text.size());			 // false for "caf\xE9", true for "café"
+std::string clean;
+utf8::appendSanitized("caf\xE9", clean);			 // "caf�"
+std::string units;
+utf8::appendUtf16("café", false, units);			 // 63 00 61 00 66 00 E9 00
+std::string back;
+utf8::appendFromUtf16(units.data(), units.size(), false, back); // "café"
+*/
+
+/* UTF-8 validation and UTF-8 <-> UTF-16 transcoding.
+ * Validation runs 32 bytes at a time on AVX2 with the lookup algorithm of Keiser & Lemire
+ * ("Validating UTF-8 in less than one instruction per byte"): three pshufb nibble lookups over each byte and the one
+ * before it flag every bad 2-byte sequence, the 3rd/4th continuation bytes are checked from the leads 2 and 3 back.
+ * Without AVX2 it's a scalar decoder with a 16-byte ASCII fast path.
+ * Invalid = what the standard says: overlongs, surrogates, > U+10FFFF, stray or missing continuation bytes. */
+
+namespace utf8
+{
+constexpr uint32_t REPLACEMENT = 0xFFFD;
+
+bool isValid(const char *data, size_t length);
+inline bool isValid(std::string_view text) { return isValid(text.data(), text.size()); }
+
+// appends "text" with every invalid sequence replaced by U+FFFD
+void appendSanitized(std::string_view text, std::string &out);
+
+// UTF-8 -> UTF-16 code units written as bytes in the given byte order, invalid sequences become U+FFFD
+void appendUtf16(std::string_view text, bool big_endian, std::string &out);
+
+// UTF-16 bytes -> UTF-8, unpaired surrogates become U+FFFD and an odd byte at the end is dropped
+void appendFromUtf16(const char *data, size_t length, bool big_endian, std::string &out);
+
+//########################################################
+// Scalar
+
+namespace detail
+{
+// length of the valid sequence at p (1-4) with its code point, 0 if it's invalid
+inline size_t decode(const unsigned char *p, const unsigned char *end, uint32_t &code_point)
+{
+	const unsigned char lead = p[0];
+	if (lead < 0x80)
+	{
+		code_point = lead;
+		return 1;
+	}
+	size_t length;
+	uint32_t minimum;
+	if (lead >= 0xC2 && lead <= 0xDF)
+		length = 2, minimum = 0x80, code_point = lead & 0x1F;
+	else if (lead >= 0xE0 && lead <= 0xEF)
+		length = 3, minimum = 0x800, code_point = lead & 0x0F;
+	else if (lead >= 0xF0 && lead <= 0xF4)
+		length = 4, minimum = 0x10000, code_point = lead & 0x07;
+	else
+		return 0;
+	if (static_cast<size_t>(end - p) < length)
+		return 0;
+	for (size_t i = 1; i < length; i++)
+	{
+		if ((p[i] & 0xC0) != 0x80)
+			return 0;
+		code_point = (code_point << 6) | (p[i] & 0x3F);
+	}
+	if (code_point < minimum || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF))
+		return 0;
+	return length;
+}
+
+// writes the UTF-8 of code_point at "out", returns the end
+inline char *writeCodePoint(uint32_t code_point, char *out)
+{
+	if (code_point < 0x80)
+		*out++ = static_cast<char>(code_point);
+	else if (code_point < 0x800)
+	{
+		*out++ = static_cast<char>(0xC0 | (code_point >> 6));
+		*out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+	}
+	else if (code_point < 0x10000)
+	{
+		*out++ = static_cast<char>(0xE0 | (code_point >> 12));
+		*out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+		*out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+	}
+	else
+	{
+		*out++ = static_cast<char>(0xF0 | (code_point >> 18));
+		*out++ = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+		*out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+		*out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+	}
+	return out;
+}
+
+inline void appendCodePoint(uint32_t code_point, std::string &out)
+{
+	char bytes[4];
+	out.append(bytes, static_cast<size_t>(writeCodePoint(code_point, bytes) - bytes));
+}
+
+inline void appendUnit(uint16_t unit, bool big_endian, std::string &out)
+{
+	const char high = static_cast<char>(unit >> 8), low = static_cast<char>(unit & 0xFF);
+	out += big_endian ? high : low;
+	out += big_endian ? low : high;
+}
+
+inline bool is_valid_scalar(const unsigned char *p, const unsigned char *end)
+{
+	while (p < end)
+	{
+		// 16 ASCII bytes at a time, most text is mostly ASCII
+		uint64_t block[2];
+		if (end - p >= 16 && (std::memcpy(block, p, 16), ((block[0] | block[1]) & 0x8080808080808080ull) == 0))
+		{
+			p += 16;
+			continue;
+		}
+		uint32_t code_point;
+		const size_t length = decode(p, end, code_point);
+		if (length == 0)
+			return false;
+		p += length;
+	}
+	return true;
+}
+
+#ifdef SIMD_X86
+// flags of the Keiser & Lemire tables, a bad sequence sets some bit in all three lookups
+constexpr uint8_t TOO_SHORT = 1 << 0;	   // lead followed by a non-continuation
+constexpr uint8_t TOO_LONG = 1 << 1;	   // ASCII followed by a continuation
+constexpr uint8_t OVERLONG_3 = 1 << 2;	   // E0 80..9F
+constexpr uint8_t TOO_LARGE = 1 << 3;	   // F4 90..BF, F5..FF
+constexpr uint8_t SURROGATE = 1 << 4;	   // ED A0..BF
+constexpr uint8_t OVERLONG_2 = 1 << 5;	   // C0, C1
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6; // F5..FF 80..8F
+constexpr uint8_t OVERLONG_4 = 1 << 6;	   // F0 80..8F
+constexpr uint8_t TWO_CONTS = 1 << 7;	   // two continuations, fine only as the 3rd/4th byte
+constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+__attribute__((target("avx2"))) inline __m256i table_avx2(uint8_t t0, uint8_t t1, uint8_t t2, uint8_t t3, uint8_t t4, uint8_t t5, uint8_t t6, uint8_t t7,
+															uint8_t t8, uint8_t t9, uint8_t t10, uint8_t t11, uint8_t t12, uint8_t t13, uint8_t t14, uint8_t t15)
+{
+	const __m128i table = _mm_setr_epi8(static_cast<char>(t0), static_cast<char>(t1), static_cast<char>(t2), static_cast<char>(t3), static_cast<char>(t4),
+										static_cast<char>(t5), static_cast<char>(t6), static_cast<char>(t7), static_cast<char>(t8), static_cast<char>(t9),
+										static_cast<char>(t10), static_cast<char>(t11), static_cast<char>(t12), static_cast<char>(t13), static_cast<char>(t14),
+										static_cast<char>(t15));
+	return _mm256_broadcastsi128_si256(table);
+}
+
+// the bytes of "input" moved forward by N, with the last N bytes of "previous" coming in at the front
+template <int N>
+__attribute__((target("avx2"))) inline __m256i previous_avx2(__m256i input, __m256i previous)
+{
+	return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+}
+
+struct Avx2State
+{
+	__m256i m_error;
+	__m256i m_previous;
+	__m256i m_previous_incomplete; // a lead in the last bytes of the block before, that needed more bytes
+};
+
+__attribute__((target("avx2"))) inline void check_avx2(__m256i input, Avx2State &state)
+{
+	if (_mm256_movemask_epi8(input) == 0) // all ASCII: only a sequence cut off by the block before can be wrong
+	{
+		state.m_error = _mm256_or_si256(state.m_error, state.m_previous_incomplete);
+		state.m_previous = input;
+		state.m_previous_incomplete = _mm256_setzero_si256();
+		return;
+	}
+	const __m256i byte_1_high = table_avx2(TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+										   TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+										   TOO_SHORT | OVERLONG_2, TOO_SHORT, TOO_SHORT | OVERLONG_3 | SURROGATE,
+										   TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+	const __m256i byte_1_low = table_avx2(CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4, CARRY | OVERLONG_2, CARRY, CARRY,
+										  CARRY | TOO_LARGE, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+										  CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+										  CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+										  CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000);
+	const __m256i byte_2_high = table_avx2(TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+										   TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+										   TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+										   TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+										   TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+										   TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+	const __m256i nibble = _mm256_set1_epi8(0x0F);
+	// positions 29/30/31 can't hold a 4/3/2 byte lead without it running into the next block
+	const __m256i incomplete_limit = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+													  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+													  static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+
+	const __m256i prev1 = previous_avx2<1>(input, state.m_previous);
+	const __m256i special = _mm256_and_si256(
+		_mm256_and_si256(_mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+						 _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nibble))),
+		_mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+	// 3rd byte after an E0+ lead or 4th after an F0+ one: has to be a continuation, which is what TWO_CONTS flagged
+	const __m256i third = _mm256_subs_epu8(previous_avx2<2>(input, state.m_previous), _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+	const __m256i fourth = _mm256_subs_epu8(previous_avx2<3>(input, state.m_previous), _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+	const __m256i must_be_continuation = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+	state.m_error = _mm256_or_si256(state.m_error, _mm256_xor_si256(must_be_continuation, special));
+	state.m_previous = input;
+	state.m_previous_incomplete = _mm256_subs_epu8(input, incomplete_limit);
+}
+
+__attribute__((target("avx2"))) inline bool is_valid_avx2(const unsigned char *p, const unsigned char *end)
+{
+	Avx2State state = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+	for (; end - p >= 32; p += 32)
+	{
+		check_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)), state);
+		if (!_mm256_testz_si256(state.m_error, state.m_error))
+			return false;
+	}
+	if (p < end) // the tail padded with zeros, which are ASCII and end every sequence
+	{
+		alignas(32) unsigned char tail[32] = {};
+		std::memcpy(tail, p, static_cast<size_t>(end - p));
+		check_avx2(_mm256_load_si256(reinterpret_cast<const __m256i *>(tail)), state);
+	}
+	const __m256i error = _mm256_or_si256(state.m_error, state.m_previous_incomplete);
+	return _mm256_testz_si256(error, error);
+}
+#endif // SIMD_X86
+} // namespace detail
+
+inline bool isValid(const char *data, size_t length)
+{
+	const auto *begin = reinterpret_cast<const unsigned char *>(data);
+#ifdef SIMD_X86
+	if (simd::currentLevel() >= simd::Level::level_avx2)
+		return detail::is_valid_avx2(begin, begin + length);
+#endif
+	return detail::is_valid_scalar(begin, begin + length);
+}
+
+inline void appendSanitized(std::string_view text, std::string &out)
+{
+	if (isValid(text))
+	{
+		out += text;
+		return;
+	}
+	const auto *p = reinterpret_cast<const unsigned char *>(text.data());
+	const auto *end = p + text.size();
+	while (p < end)
+	{
+		uint32_t code_point;
+		const size_t length = detail::decode(p, end, code_point);
+		if (length == 0)
+		{
+			detail::appendCodePoint(REPLACEMENT, out);
+			p++;
+			continue;
+		}
+		out.append(reinterpret_cast<const char *>(p), length);
+		p += length;
+	}
+}
+
+inline void appendUtf16(std::string_view text, bool big_endian, std::string &out)
+{
+	const auto *p = reinterpret_cast<const unsigned char *>(text.data());
+	const auto *end = p + text.size();
+	while (p < end)
+	{
+		uint32_t code_point;
+		const size_t length = detail::decode(p, end, code_point);
+		if (length == 0)
+			code_point = REPLACEMENT;
+		p += length == 0 ? 1 : length;
+		if (code_point < 0x10000)
+			detail::appendUnit(static_cast<uint16_t>(code_point), big_endian, out);
+		else
+		{
+			code_point -= 0x10000;
+			detail::appendUnit(static_cast<uint16_t>(0xD800 | (code_point >> 10)), big_endian, out);
+			detail::appendUnit(static_cast<uint16_t>(0xDC00 | (code_point & 0x3FF)), big_endian, out);
+		}
+	}
+}
+
+inline void appendFromUtf16(const char *data, size_t length, bool big_endian, std::string &out)
+{
+	const auto *p = reinterpret_cast<const unsigned char *>(data);
+	const auto *end = p + (length & ~size_t(1));
+	auto unitAt = [&](const unsigned char *at) -> uint32_t {
+		return big_endian ? (uint32_t(at[0]) << 8) | at[1] : (uint32_t(at[1]) << 8) | at[0];
+	};
+	// a unit is at most 3 bytes of UTF-8 (a surrogate pair is 4 for 2 units), written in place instead of += per byte
+	const size_t start = out.size();
+	out.resize(start + static_cast<size_t>(end - p) / 2 * 3);
+	char *o = out.data() + start;
+	const uint64_t ascii_mask = big_endian ? 0x80FF80FF80FF80FFull : 0xFF80FF80FF80FF80ull;
+	while (p < end)
+	{
+		uint64_t units;
+		if (end - p >= 8 && (std::memcpy(&units, p, 8), (units & ascii_mask) == 0)) // 4 ASCII units
+		{
+			for (size_t i = 0; i < 4; i++)
+				*o++ = static_cast<char>(p[2 * i + big_endian]);
+			p += 8;
+			continue;
+		}
+		uint32_t code_point = unitAt(p);
+		p += 2;
+		if (code_point >= 0xD800 && code_point <= 0xDFFF)
+		{
+			const uint32_t low = p < end ? unitAt(p) : 0;
+			if (code_point <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF)
+			{
+				code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+				p += 2;
+			}
+			else
+				code_point = REPLACEMENT;
+		}
+		o = detail::writeCodePoint(code_point, o);
+	}
+	out.resize(static_cast<size_t>(o - out.data()));
+}
+} // namespace utf8
+
+#endif // utf8.hpp
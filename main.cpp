@@ -2,55 +2,656 @@
 #include "libutils/src/color.hpp"
 #include "libutils/src/cliparser.hpp"
 #include "libutils/src/file.hpp"
+#include "libutils/src/timer.hpp"
+
+#include "src/matcher.hpp"
+#include "src/scanner.hpp"
+#include "src/parallel.hpp"
+#include "src/walker.hpp"
+#include "src/workpool.hpp"
+#include "src/output.hpp"
+#include "src/index.hpp"
+#include "src/suffixindex.hpp"
+#include "src/blockfilter.hpp"
+#include "src/uring.hpp"
+#include "src/binary.hpp"
+#include "src/encoding.hpp"
+#include "src/stats.hpp"
+
+#include <iostream>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <limits>
+#include <unordered_map>
 
 using funcs::print;
 
+// same exit codes as grep, so scripts can tell "no match" from "something went wrong"
+constexpr int EXIT_MATCH = 0;
+constexpr int EXIT_NO_MATCH = 1;
+constexpr int EXIT_TROUBLE = 2;
+
+// one file of a directory search, with the blocks to read when the trigram index narrowed it down
+struct SearchTask
+{
+	std::string m_path;
+	const trigram::IndexedFile *m_indexed = nullptr; // nullptr = search the whole file
+	std::vector<trigram::CandidateRange> m_ranges;
+};
+
 int main(int argc, char *argv[])
 {
+	std::ios::sync_with_stdio(false); // hits don't go through iostreams anyway, see OutputSink
+	std::cin.tie(nullptr);
+	color::autoDetect();
 	CLIParser parser(argc, argv);
 
 	auto printHelp = [&/*capture everything*/]() -> void {
 		print /*useless comment*/ ("Usage:\n");
-		print(argv[0], " ", color::TXT_CYAN, "<FILE>", color::_RESET, "\n");
+		print(argv[0], " ", color::TXT_CYAN, "[OPTIONS] <FILE|DIRECTORY>", color::_RESET, "\n\n");
+		print("Options:\n");
+		print("  -h        show this help\n");
+		print("  -j N      search on N threads (0 = one per core, the default for directories)\n");
+		print("  -f FILE   search for every line of FILE at once instead of asking for the text\n");
+		print("  -i        ignore (ASCII) case\n");
+		print("  -e REGEX  search for lines matching REGEX (. [] * + ? {m,n} | () ^ $ \\d \\w \\s)\n");
+		print("  -c        only print how many lines match\n");
+		print("  -l        only print the names of files that match\n");
+		print("  -q        print nothing, exit with 0 if something matched, 1 if not\n");
+		print("  -m N      stop after N matching lines (per file)\n");
+		print("  --index DIR  build (or update) a trigram index of DIR, later searches of DIR only read the blocks that can match\n");
+		print("  --suffix-index FILE  build a suffix array of FILE, later searches of FILE look literals up instead of scanning\n");
+		print("  --block-filter  keep Bloom filters of FILE's blocks (built during this search), later searches skip blocks that can't match\n");
+		print("  --no-index   search without the trigram index, suffix array or block filters\n");
+		print("  --binary=skip|match|text  what to do with binary files: never match them, only say they match (the default), or print their lines\n");
+		print("  --encoding=auto|utf8|utf16le|utf16be  auto: UTF-16 when the file starts with a BOM, bytes otherwise. utf8: print invalid sequences as U+FFFD\n");
+		print("  --no-uring   open and read the files of a directory one syscall at a time instead of batching them through io_uring\n");
+		print("  --stats      print where the search spent its time (open, read, match, line, output) to stderr when it's done\n");
+		print("\ngzip and zstd compressed files are decompressed while they're searched.\n");
+		print("Exit status: 0 if a line matched, 1 if none did, 2 on errors.\n");
 	};
 
-	if (argc != 2)
+	if (parser.m_hasFlag("-h"))
 	{
 		printHelp();
-		return EXIT_FAILURE;
+		return EXIT_SUCCESS;
 	}
-	std::string filepath = parser.m_getArg(1);
-	if (!File::m_isfile(filepath))
+
+	// options that take a value, so their value isn't mistaken for the file
+	const std::vector<std::string> value_flags = {"-j", "-f", "-e", "-m", "--index", "--suffix-index"};
+	std::string filepath;
+	for (int i = 1; i < argc; i++)
 	{
-		print("'", filepath, "' is not a file or doesn't exist.\n");
-		return EXIT_FAILURE;
+		std::string arg = parser.m_getArg(i);
+		if (std::find(value_flags.begin(), value_flags.end(), arg) != value_flags.end())
+			i++;
+		else if (arg.size() > 1 && arg[0] == '-')
+			continue;
+		else if (filepath.empty())
+			filepath = arg;
 	}
 
-	if (parser.m_hasFlag("-h"))
+	unsigned requested_threads = parallel::resolveThreads(0);
+	if (parser.m_hasFlag("-j"))
 	{
-		printHelp();
+		std::string value = parser.m_getValue("-j");
+		if (value.empty() || value.size() > 9 || !std::all_of(value.begin(), value.end(), ::isdigit))
+		{
+			print("-j expects a number of threads.\n");
+			return EXIT_TROUBLE;
+		}
+		requested_threads = parallel::resolveThreads(static_cast<unsigned>(std::stoul(value)));
+	}
+
+	if (parser.m_hasFlag("--index"))
+	{
+		const std::string dir = parser.m_getValue("--index");
+		if (!File::m_isdirectory(dir))
+		{
+			print("'", dir, "' is not a directory.\n");
+			return EXIT_TROUBLE;
+		}
+		Timer timer;
+		try
+		{
+			trigram::IndexWriter writer(dir);
+			const trigram::BuildStats stats = writer.m_update(requested_threads);
+			const bool merging = writer.m_startMerge(); // queries already see the update while this runs
+			if (stats.m_full)
+				print("Indexed ", stats.m_files, " files (", stats.m_bytes >> 20, " MB) in ", static_cast<uint64_t>(timer.m_elapsed() * 1000), " ms: ",
+					  stats.m_blocks, " blocks, ", stats.m_trigrams, " trigrams, index is ", stats.m_index_bytes >> 10, " KB.\n");
+			else if (stats.m_added + stats.m_changed + stats.m_deleted == 0)
+				print("Index of ", stats.m_files, " files is up to date (", static_cast<uint64_t>(timer.m_elapsed() * 1000), " ms).\n");
+			else
+				print("Updated index in ", static_cast<uint64_t>(timer.m_elapsed() * 1000), " ms: ", stats.m_added, " added, ", stats.m_changed, " changed, ",
+					  stats.m_deleted, " deleted (", stats.m_bytes >> 10, " KB tokenized), ", stats.m_files, " files in ", stats.m_segments, " segments.\n");
+
+			if (merging)
+			{
+				Timer merge_timer;
+				const trigram::MergeStats merged = writer.m_finishMerge();
+				print("Merged ", merged.m_merged, " segments into one of ", merged.m_bytes >> 10, " KB in ", static_cast<uint64_t>(merge_timer.m_elapsed() * 1000), " ms.\n");
+			}
+		}
+		catch (const std::exception &error)
+		{
+			print(error.what(), "\n");
+			return EXIT_TROUBLE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	if (parser.m_hasFlag("--suffix-index"))
+	{
+		const std::string path = parser.m_getValue("--suffix-index");
+		Timer timer;
+		try
+		{
+			const suffix::BuildStats stats = suffix::buildSuffixIndex(path);
+			print("Indexed ", stats.m_covered >> 20, " MB (", stats.m_lines, " lines) in ", static_cast<uint64_t>(timer.m_elapsed() * 1000), " ms, suffix array is ",
+				  stats.m_index_bytes >> 20, " MB.\n");
+		}
+		catch (const std::exception &error)
+		{
+			print(error.what(), "\n");
+			return EXIT_TROUBLE;
+		}
 		return EXIT_SUCCESS;
 	}
 
-	std::ifstream file(filepath);
-	if (!file.is_open())
+	if (filepath.empty())
+	{
+		printHelp();
+		return EXIT_TROUBLE;
+	}
+	if (!fs::exists(filepath)) // pipes and special files are fine too
+	{
+		print("'", filepath, "' is not a file or doesn't exist.\n");
+		return EXIT_TROUBLE;
+	}
+	const bool is_directory = File::m_isdirectory(filepath);
+
+	const unsigned threads = parser.m_hasFlag("-j") ? requested_threads : (is_directory ? parallel::resolveThreads(0) : 1);
+
+	// -q and -l know the answer at the first hit, -c only needs the number, none of them need the lines
+	const bool quiet = parser.m_hasFlag("-q");
+	const bool list_files = parser.m_hasFlag("-l");
+	const bool count_only = parser.m_hasFlag("-c");
+	const bool counting = quiet || list_files || count_only;
+	uint64_t max_count = std::numeric_limits<uint64_t>::max();
+	if (parser.m_hasFlag("-m"))
+	{
+		std::string value = parser.m_getValue("-m");
+		if (value.empty() || value.size() > 18 || !std::all_of(value.begin(), value.end(), ::isdigit))
+		{
+			print("-m expects a number of lines.\n");
+			return EXIT_TROUBLE;
+		}
+		max_count = std::stoull(value);
+	}
+	if (quiet || list_files)
+		max_count = std::min<uint64_t>(max_count, 1);
+	binary::Policy binary_policy = binary::Policy::match;
+	encoding::Encoding requested_encoding = encoding::Encoding::automatic;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = parser.m_getArg(i);
+		if (arg.rfind("--binary=", 0) == 0 && !binary::parsePolicy(std::string_view(arg).substr(9), binary_policy))
+		{
+			print("--binary expects skip, match or text.\n");
+			return EXIT_TROUBLE;
+		}
+		if (arg.rfind("--encoding=", 0) == 0 && !encoding::parseEncoding(std::string_view(arg).substr(11), requested_encoding))
+		{
+			print("--encoding expects auto, utf8, utf16le or utf16be.\n");
+			return EXIT_TROUBLE;
+		}
+	}
+
+	profiler::enable(parser.m_hasFlag("--stats")); // before any thread starts
+	InputFile file;
+	bool opened;
+	{
+		profiler::Scope<stats::Zone::open> zone;
+		opened = is_directory || file.m_open(filepath);
+	}
+	if (!opened)
+	{
+		std::cerr << "Couldn't open file: Permission Denied.\n"; // stderr like grep, stdout may be feeding -l into xargs
+		return EXIT_TROUBLE;
+	}
+
+	const bool case_insensitive = parser.m_hasFlag("-i");
+	std::vector<std::string> patterns;
+	Regex regex;
+	if (parser.m_hasFlag("-e"))
+	{
+		if (!regex.m_compile(parser.m_getValue("-e"), case_insensitive))
+		{
+			print("Bad regex: ", regex.m_error(), "\n");
+			return EXIT_TROUBLE;
+		}
+	}
+	else if (parser.m_hasFlag("-f"))
+	{
+		std::string patterns_path = parser.m_getValue("-f");
+		if (!File::m_isfile(patterns_path))
+		{
+			print("'", patterns_path, "' is not a file or doesn't exist.\n");
+			return EXIT_TROUBLE;
+		}
+		for (std::string &pattern : File::m_readfile(patterns_path))
+		{
+			if (!pattern.empty() && pattern.back() == '\r') // patterns written on Windows
+				pattern.pop_back();
+			if (!pattern.empty())
+				patterns.push_back(std::move(pattern));
+		}
+		if (patterns.empty())
+		{
+			print("'", patterns_path, "' has no patterns in it.\n");
+			return EXIT_TROUBLE;
+		}
+	}
+	else
+	{
+		const bool prompt = !quiet && isatty(STDIN_FILENO) == 1; // piped in, the prompt would only end up in the output
+		if (prompt)
+			print("Enter text to find:\n> ", color::TXT_GREEN, color::_ITALIC);
+		std::string to_find;
+		std::cout.flush(); // cin isn't tied to cout anymore
+		std::getline(std::cin, to_find);
+		if (prompt)
+			print(color::_RESET);
+		patterns.push_back(std::move(to_find));
+	}
+
+	const std::unique_ptr<Matcher> matcher_ptr = parser.m_hasFlag("-e") ? makeRegexMatcher(std::move(regex), case_insensitive)
+																	   : makeMatcher(patterns, case_insensitive);
+	const Matcher &matcher = *matcher_ptr;
+
+	// UTF-16 files get the literals transcoded once per byte order, the first time a file needs them
+	std::unique_ptr<encoding::Utf16Matcher> utf16_matchers[2];
+	std::once_flag utf16_once[2];
+	auto utf16Matcher = [&](encoding::Encoding file_encoding) -> const encoding::Utf16Matcher & {
+		const bool big_endian = file_encoding == encoding::Encoding::utf16be;
+		std::call_once(utf16_once[big_endian], [&]() {
+			utf16_matchers[big_endian] = std::make_unique<encoding::Utf16Matcher>(matcher, big_endian, !parser.m_hasFlag("-e") && !case_insensitive, case_insensitive);
+		});
+		return *utf16_matchers[big_endian];
+	};
+
+	// out is an OutputSink or an OutputBuffer. No zone of its own, it's called per hit: the searchers time their reports a batch at a time
+	auto formatHit = [&](auto &out, const ScanHit &hit) -> void {
+		thread_local std::string found;
+		found.clear();
+		matcher.m_describe(hit.m_line, found);
+		out.m_append("'");
+		out.m_append(found);
+		out.m_append("' found on line ");
+		out.m_append(color::TXT_RED);
+		out.m_append("(");
+		out.m_appendNumber(hit.m_line_number);
+		out.m_append(")");
+		out.m_append(color::_RESET);
+		out.m_append(":\n");
+		if (requested_encoding == encoding::Encoding::utf8)
+		{
+			thread_local std::string line;
+			line.clear();
+			utf8::appendSanitized(hit.m_line, line);
+			out.m_append(line);
+		}
+		else
+			out.m_append(hit.m_line);
+		out.m_append("\n\n");
+	};
+	auto formatBinaryMatch = [&](auto &out, std::string_view path) -> void {
+		profiler::Scope<stats::Zone::output> zone;
+		out.m_append("Binary file ");
+		out.m_append(color::TXT_CYAN);
+		out.m_append(path);
+		out.m_append(color::_RESET);
+		out.m_append(" matches\n");
+	};
+
+	std::cout.flush(); // the prompt, everything from here on goes through the sink
+	stats::Report stats_report; // --stats, printed after the sink below is flushed and gone
+	OutputSink sink;
+
+	if (is_directory)
 	{
-		print("Couldn't open file: Permission Denied.\n");
+		// with an index only the files (and blocks) that can match are read, otherwise everything is.
+		// The tree is listed either way (biggest files first, so a huge file found late doesn't become the tail of the run):
+		// files that were added or changed since the index was updated aren't covered by it and get searched whole
+		std::vector<SearchTask> tasks;
+		std::vector<FileEntry> entries = walker::listFiles(filepath, threads);
+		entries.erase(std::remove_if(entries.begin(), entries.end(), [](const FileEntry &entry) { return trigram::isIndexFile(entry.m_path); }), entries.end());
+		trigram::TrigramIndex index;
+		std::vector<trigram::CandidateFile> candidates;
+		const bool every_file = count_only && !list_files && !quiet; // -c prints path:0 for the others too
+		if (!parser.m_hasFlag("--no-index") && index.m_open(filepath) && index.m_candidates(matcher.m_requiredLiterals(), candidates, every_file))
+		{
+			std::unordered_map<std::string_view, trigram::CandidateFile *> candidate_paths;
+			for (trigram::CandidateFile &candidate : candidates)
+				candidate_paths.emplace(candidate.m_path, &candidate);
+			std::unordered_map<std::string_view, const trigram::IndexedFile *> indexed;
+			index.m_forEachFile([&](std::string_view path, const trigram::IndexedFile &indexed_file) { indexed.emplace(path, &indexed_file); });
+
+			const size_t prefix = walker::joinPath(filepath, "").size();
+			for (FileEntry &entry : entries) // indexed files that are gone from disk are left out with this too
+			{
+				const std::string_view relative = std::string_view(entry.m_path).substr(prefix);
+				if (const auto candidate = candidate_paths.find(relative); candidate != candidate_paths.end())
+				{
+					tasks.push_back({std::move(entry.m_path), candidate->second->m_file, std::move(candidate->second->m_ranges)});
+					continue;
+				}
+				const auto known = indexed.find(relative);
+				if (known == indexed.end() || known->second->m_size != entry.m_size || known->second->m_mtime != entry.m_mtime)
+					tasks.push_back({std::move(entry.m_path), nullptr, {}});
+			}
+		}
+		else
+		{
+			for (FileEntry &entry : entries)
+				tasks.push_back({std::move(entry.m_path), nullptr, {}});
+		}
+
+		// without an index every file gets opened and read whole, io_uring takes the syscalls off the search threads
+		std::vector<const char *> loader_paths;
+		uring::FileLoader loader;
+		bool use_loader = false;
+		if (!parser.m_hasFlag("--no-uring") && !tasks.empty() &&
+			std::none_of(tasks.begin(), tasks.end(), [](const SearchTask &task) { return task.m_indexed != nullptr; }))
+		{
+			for (const SearchTask &task : tasks)
+				loader_paths.push_back(task.m_path.c_str());
+			use_loader = loader.m_start(loader_paths);
+		}
+
+		WorkStealingPool<const SearchTask *> pool(threads);
+		for (size_t i = 0; i < tasks.size(); i++)
+			pool.m_push(static_cast<unsigned>(i), &tasks[i]);
+
+		std::mutex output_mutex;
+		std::vector<OutputBuffer> buffers(threads);
+		std::vector<std::unique_ptr<Matcher>> thread_matchers(threads); // one per worker for matchers with state
+		for (auto &thread_matcher : thread_matchers)
+			thread_matcher = matcher.m_clone();
+
+		std::atomic<bool> any_match{false};
+		std::atomic<bool> trouble{false}; // a file couldn't be opened or read, that's exit status 2 like grep
+		auto reportTrouble = [&](const std::string &path, const InputFile *input) -> void {
+			trouble.store(true);
+			if (quiet)
+				return;
+			std::string message;
+			if (input == nullptr)
+				message = "Couldn't open '" + path + "'.\n";
+			else if (!decompress::isAvailable(input->m_compression()))
+				message = "'" + path + "' is zstd compressed and libzstd isn't installed.\n";
+			else
+				message = "Couldn't read '" + path + "'.\n";
+			std::lock_guard<std::mutex> lock(output_mutex);
+			std::cerr << message;
+		};
+		pool.m_run([&](const SearchTask *task, unsigned worker) {
+			const Matcher &thread_matcher = thread_matchers[worker] != nullptr ? *thread_matchers[worker] : matcher;
+			uring::LoadedFile loaded; // outlives input, which only borrows its fd
+			InputFile input;
+			{
+				profiler::Scope<stats::Zone::open> zone;
+				if (use_loader && loader.m_take(static_cast<size_t>(task - tasks.data()), loaded))
+					input.m_adopt(loaded.m_fd(), loaded.m_stat(), loaded.m_contents());
+				else if (!input.m_open(task->m_path))
+				{
+					reportTrouble(task->m_path, nullptr);
+					return;
+				}
+			}
+			const encoding::Encoding file_encoding = encoding::detect(input, requested_encoding);
+			const bool utf16 = encoding::isUtf16(file_encoding);
+			// a file that changed since it was indexed gets searched whole, and so does a compressed one
+			// (its blocks were indexed at offsets of the decompressed text) or a UTF-16 one
+			const bool use_ranges = task->m_indexed != nullptr && input.m_size() == task->m_indexed->m_size && input.m_mtime() == task->m_indexed->m_mtime &&
+									input.m_compression() == decompress::Compression::none && !utf16;
+			// decided on the 64KB the open already read, a skipped binary is never read any further.
+			// UTF-16 is half NULs, it's text all the same
+			const bool binary_file = !utf16 && binary_policy != binary::Policy::text && binary::isBinary(input);
+			const bool skip_file = binary_file && binary_policy == binary::Policy::skip;
+
+			// the whole file's output is built first and written in one go, so files never interleave
+			OutputBuffer &out = buffers[worker];
+			out.m_clear();
+			bool ok = true;
+			if (counting)
+			{
+				uint64_t count = 0;
+				auto stop = [&]() -> bool { return pool.m_cancelled(); };
+				if (skip_file)
+					; // counts as 0
+				else if (utf16)
+					ok = encoding::countMatches(input, utf16Matcher(file_encoding), thread_matcher, max_count, count, stop);
+				else if (use_ranges)
+				{
+					ok = trigram::forEachRange(input, task->m_ranges, [&](std::string_view block, uint64_t, uint64_t) -> bool {
+						count += scanner::countBlock(thread_matcher, block, max_count - count, stop);
+						return count < max_count && !stop();
+					});
+				}
+				else
+					ok = scanner::countMatches(input, thread_matcher, max_count, count, stop);
+				if (!ok)
+					reportTrouble(task->m_path, &input);
+				if (count > 0)
+					any_match.store(true);
+				if (quiet)
+				{
+					if (count > 0)
+						pool.m_cancel(); // the answer is known, every other worker stops too
+					return;
+				}
+				if (list_files && count == 0)
+					return;
+
+				out.m_append(color::TXT_CYAN);
+				out.m_append(task->m_path);
+				out.m_append(color::_RESET);
+				if (!list_files)
+				{
+					out.m_append(":");
+					out.m_appendNumber(count);
+				}
+				out.m_append("\n");
+			}
+			else if (max_count == 0)
+				; // -m 0: nothing to print, same as for a single file
+			else if (binary_file)
+			{
+				// binary lines aren't worth printing, one hit says all there is to say
+				bool found = false;
+				if (!skip_file)
+				{
+					ok = scanner::searchFile(input, thread_matcher, [&](const ScanHit &) -> bool {
+						found = true;
+						return false;
+					});
+				}
+				if (found)
+				{
+					any_match.store(true);
+					formatBinaryMatch(out, task->m_path);
+				}
+			}
+			else
+			{
+				uint64_t hits = 0;
+				auto report = [&](const ScanHit &hit) -> bool {
+					if (out.m_empty())
+					{
+						out.m_append(color::TXT_CYAN);
+						out.m_append(task->m_path);
+						out.m_append(color::_RESET);
+						out.m_append(":\n");
+					}
+					formatHit(out, hit);
+					return ++hits < max_count;
+				};
+				if (utf16)
+					ok = encoding::searchFile(input, utf16Matcher(file_encoding), thread_matcher, report);
+				else if (use_ranges)
+				{
+					ok = trigram::forEachRange(input, task->m_ranges, [&](std::string_view block, uint64_t offset, uint64_t first_line) -> bool {
+						LineSearcher searcher(thread_matcher, first_line);
+						return searcher.m_searchBlock(block, offset, report);
+					});
+				}
+				else
+					ok = scanner::searchFile(input, thread_matcher, report);
+				if (hits > 0)
+					any_match.store(true);
+			}
+			if (!counting && !ok)
+				reportTrouble(task->m_path, &input); // after what was found before the error
+
+			if (!out.m_empty())
+			{
+				profiler::Scope<stats::Zone::output> zone;
+				std::lock_guard<std::mutex> lock(output_mutex);
+				sink.m_append(out.m_view());
+			}
+		});
+		{
+			profiler::Scope<stats::Zone::output> zone;
+			sink.m_flush();
+		}
+		if (!sink.m_ok())
+		{
+			std::cerr << "Couldn't write the output.\n"; // stdout is what failed
+			return EXIT_TROUBLE;
+		}
+		if (quiet && any_match.load())
+			return EXIT_MATCH; // like grep -q, a match wins over errors
+		if (trouble.load())
+			return EXIT_TROUBLE;
+		return any_match.load() ? EXIT_MATCH : EXIT_NO_MATCH;
 	}
 
-	print("Enter text to find:\n> ", color::TXT_GREEN, color::_ITALIC);
-	std::string to_find;
-	std::getline(std::cin, to_find);
-	print(color::_RESET);
+	const encoding::Encoding file_encoding = encoding::detect(file, requested_encoding);
+	const bool utf16 = encoding::isUtf16(file_encoding);
+	const bool binary_file = !utf16 && binary_policy != binary::Policy::text && binary::isBinary(file);
+	const bool skip_file = binary_file && binary_policy == binary::Policy::skip;
+
+	// a suffix array next to the file turns the literals into candidate lines without reading the file.
+	// It's built on the raw bytes, so -i always scans, and so does UTF-16 (the same goes for block filters)
+	suffix::SuffixIndex suffix_index;
+	std::vector<uint64_t> candidate_lines;
+	const bool use_suffix_index = !parser.m_hasFlag("--no-index") && !case_insensitive && !utf16 && file.m_isMappable() && suffix_index.m_open(filepath, file) &&
+								  suffix_index.m_candidateLines(matcher.m_requiredLiterals(), candidate_lines);
+
+	const bool use_threads = threads > 1 && !utf16 && file.m_isMappable();
 
-	std::string line;
-	uint64_t line_number = 1;
-	while (std::getline(file, line))
+	// per-block Bloom filters: with fresh ones only the blocks that can match get read (by -j threads a range
+	// each, no bigger than a -j chunk), --block-filter builds them during this (single-threaded) scan when there are none yet
+	blockfilter::BlockFilter block_filter;
+	std::vector<trigram::CandidateRange> filter_ranges;
+	const bool try_block_filter = !use_suffix_index && !parser.m_hasFlag("--no-index") && !utf16 && file.m_isMappable() && file.m_size() >= blockfilter::MIN_FILE_SIZE;
+	const bool has_block_filter = try_block_filter && block_filter.m_open(filepath, file);
+	const uint64_t max_range = use_threads ? parallel::chunkSizeFor(file.m_size(), threads) : trigram::MAX_RANGE_SIZE;
+	const bool use_block_filter = has_block_filter && block_filter.m_candidates(matcher.m_requiredLiterals(), filter_ranges, max_range);
+	const bool build_block_filter = try_block_filter && !has_block_filter && parser.m_hasFlag("--block-filter");
+
+	decompress::setThreads(threads); // a compressed file can't be cut into chunks, but its gzip members/zstd frames can be
+	bool ok;
+	uint64_t hits = 0;
+	if (counting)
 	{
-		if (funcs::hasSequence(line, to_find))
+		auto count = [&](const ScanHit &) -> bool { return ++hits < max_count; };
+		if (skip_file)
+			ok = true;
+		else if (utf16)
+			ok = encoding::countMatches(file, utf16Matcher(file_encoding), matcher, max_count, hits, []() -> bool { return false; });
+		else if (use_suffix_index)
+			ok = suffix::searchFile(file, suffix_index, matcher, candidate_lines, false, count);
+		else if (use_block_filter && use_threads)
+			ok = blockfilter::countRanges(file, filter_ranges, matcher, threads, max_count, hits);
+		else if (use_block_filter)
+			ok = blockfilter::searchRanges(file, filter_ranges, matcher, count);
+		else if (build_block_filter)
+			ok = blockfilter::searchAndBuild(filepath, file, matcher, count);
+		else if (use_threads)
+			ok = parallel::countMatches(file, matcher, threads, max_count, hits);
+		else
+			ok = scanner::countMatches(file, matcher, max_count, hits, []() -> bool { return false; });
+
+		if (ok && list_files && !quiet && hits > 0)
 		{
-			print("'", to_find, "' found on line ", color::TXT_RED, "(", line_number, ")", color::_RESET, ":\n", line, "\n\n");
+			sink.m_append(color::TXT_CYAN);
+			sink.m_append(filepath);
+			sink.m_append(color::_RESET);
+			sink.m_append("\n");
 		}
-		line_number++;
+		else if (ok && count_only && !list_files && !quiet)
+		{
+			sink.m_appendNumber(hits);
+			sink.m_append("\n");
+		}
+	}
+	else if (max_count == 0 || skip_file)
+		ok = true;
+	else if (binary_file)
+	{
+		ok = scanner::searchFile(file, matcher, [&](const ScanHit &) -> bool {
+			hits++;
+			return false;
+		});
+		if (hits > 0)
+			formatBinaryMatch(sink, filepath);
+	}
+	else
+	{
+		auto report = [&](const ScanHit &hit) -> bool {
+			formatHit(sink, hit);
+			return ++hits < max_count;
+		};
+		if (utf16)
+			ok = encoding::searchFile(file, utf16Matcher(file_encoding), matcher, report);
+		else if (use_suffix_index)
+			ok = suffix::searchFile(file, suffix_index, matcher, candidate_lines, true, report);
+		else if (use_block_filter && use_threads)
+			ok = blockfilter::searchRanges(file, filter_ranges, matcher, threads, report);
+		else if (use_block_filter)
+			ok = blockfilter::searchRanges(file, filter_ranges, matcher, report);
+		else if (build_block_filter)
+			ok = blockfilter::searchAndBuild(filepath, file, matcher, report);
+		else if (use_threads)
+			ok = parallel::searchFile(file, matcher, threads, report);
+		else
+			ok = scanner::searchFile(file, matcher, report);
+	}
+
+	{
+		profiler::Scope<stats::Zone::output> zone;
+		sink.m_flush();
+	}
+	if (!sink.m_ok())
+	{
+		std::cerr << "Couldn't write the output.\n"; // stdout is what failed
+		return EXIT_TROUBLE;
+	}
+	if (quiet && hits > 0)
+		return EXIT_MATCH; // like grep -q, a match wins over a read error
+	if (!ok && !decompress::isAvailable(file.m_compression()))
+	{
+		std::cerr << "'" << filepath << "' is zstd compressed and libzstd isn't installed.\n";
+		return EXIT_TROUBLE;
+	}
+	if (!ok)
+	{
+		std::cerr << "Couldn't read '" << filepath << "'.\n";
+		return EXIT_TROUBLE;
 	}
-}
\ No newline at end of file
+	return hits > 0 ? EXIT_MATCH : EXIT_NO_MATCH;
+}
@@ -0,0 +1,64 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef BINARY_HPP
+#define BINARY_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstring>
+
+#include "scanner.hpp"
+#include "decompress.hpp"
+#include "../libutils/src/simd.hpp"
+
+/* Telling binary files (object files, images, core dumps...) apart from text, from the first 64KB
+ * InputFile already read when it opened the file, so a big binary costs that one read and no scan.
+ * Binary = a NUL byte, or more than 1 byte in 32 being a control character text doesn't use.
+ * Compressed files are judged on their decompressed start. Pipes aren't sniffed, they count as text. */
+
+namespace binary
+{
+enum class Policy
+{
+	skip,  // binary files never match
+	match, // searched, but only "Binary file X matches" gets printed (the default, like grep)
+	text,  // searched and printed like any other file
+};
+
+inline bool parsePolicy(std::string_view name, Policy &policy)
+{
+	if (name == "skip")
+		policy = Policy::skip;
+	else if (name == "match")
+		policy = Policy::match;
+	else if (name == "text")
+		policy = Policy::text;
+	else
+		return false;
+	return true;
+}
+
+inline bool looksBinary(std::string_view head)
+{
+	if (head.empty())
+		return false;
+	if (std::memchr(head.data(), '\0', head.size()) != nullptr)
+		return true;
+	return simd::countControl(head.data(), head.data() + head.size()) * 32 > head.size();
+}
+
+inline bool isBinary(const InputFile &input)
+{
+	if (input.m_compression() == decompress::Compression::none)
+		return looksBinary(input.m_head());
+	static thread_local std::vector<char> text;
+	text.resize(scanner::HEAD_SIZE);
+	const size_t length = decompress::peek(input.m_head(), input.m_compression(), text.data(), text.size());
+	return looksBinary(std::string_view(text.data(), length));
+}
+} // namespace binary
+
+#endif // binary.hpp
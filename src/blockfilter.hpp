@@ -0,0 +1,269 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef BLOCKFILTER_HPP
+#define BLOCKFILTER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <span>
+#include <exception>
+#include <cstdint>
+#include <cstring>
+
+#include "matcher.hpp"
+#include "scanner.hpp"
+#include "walker.hpp"
+#include "index.hpp" // trigram::pack, CandidateRange, forEachRange
+#include "parallel.hpp"
+#include "../libutils/src/binarycache.hpp"
+
+/* Per-block Bloom filters of a big file, kept next to it as .txtfind-bloom.NAME (BinaryCache sections):
+ *   0 header, 1 blocks (offset, length, first line), 2 filters (FILTER_WORDS per block)
+ * The file is cut into blocks of whole lines (~256KB) and each one gets a 16KB Bloom filter of its
+ * (ASCII folded) trigrams. A search then only reads the blocks whose filter has every trigram of one of
+ * the literals, the rest of the file never gets read, which is what counts with a cold page cache.
+ * The filters are built on the side of a normal scan (--block-filter), and only used while the
+ * file's size and mtime are still the ones they were built from. */
+
+namespace blockfilter
+{
+constexpr const char *FILTER_PREFIX = ".txtfind-bloom.";
+constexpr uint32_t FORMAT_VERSION = 1;
+constexpr size_t BLOCK_SIZE = size_t(256) << 10;
+constexpr size_t FILTER_BITS = size_t(1) << 17; // 16KB per 256KB block, ~5% false positives per trigram at 20k distinct ones
+constexpr size_t FILTER_WORDS = FILTER_BITS / 64;
+constexpr uint64_t MIN_FILE_SIZE = uint64_t(4) << 20; // smaller files are read about as fast as their filters
+
+struct FilterHeader
+{
+	uint32_t m_version;
+	uint32_t m_block_size;
+	uint64_t m_file_size;
+	int64_t m_mtime;
+	uint64_t m_blocks;
+	uint64_t m_filter_bits;
+};
+
+inline std::string sidecarPath(const std::string &path)
+{
+	return walker::sidecarPath(path, FILTER_PREFIX);
+}
+
+// the 3 filter bits of a trigram, from one multiply
+inline void trigramBits(uint32_t trigram, uint32_t bits[3])
+{
+	const uint64_t hash = static_cast<uint64_t>(trigram) * 0x9E3779B97F4A7C15ull;
+	bits[0] = static_cast<uint32_t>(hash >> 47) & (FILTER_BITS - 1);
+	bits[1] = static_cast<uint32_t>(hash >> 30) & (FILTER_BITS - 1);
+	bits[2] = static_cast<uint32_t>(hash >> 13) & (FILTER_BITS - 1);
+}
+
+class FilterBuilder
+{
+  public:
+	// blocks have to come in file order and start on a line, like the scanner hands them out
+	void m_add(std::string_view block, uint64_t offset, uint64_t first_line)
+	{
+		const char *cursor = block.data();
+		const char *end = cursor + block.size();
+		while (cursor < end)
+		{
+			// same cut as the trigram index: the last '\n' within BLOCK_SIZE, a longer line makes a longer block
+			const char *stop = end;
+			if (static_cast<size_t>(end - cursor) > BLOCK_SIZE)
+			{
+				const char *newline = static_cast<const char *>(::memrchr(cursor, '\n', BLOCK_SIZE));
+				if (newline == nullptr)
+					newline = static_cast<const char *>(std::memchr(cursor + BLOCK_SIZE, '\n', static_cast<size_t>(end - cursor) - BLOCK_SIZE));
+				stop = newline != nullptr ? newline + 1 : end;
+			}
+			p_blocks.push_back({offset + static_cast<uint64_t>(cursor - block.data()), static_cast<uint64_t>(stop - cursor), first_line});
+			p_addFilter(cursor, stop);
+			first_line += simd::count(cursor, stop, '\n');
+			cursor = stop;
+		}
+	}
+
+	// throws std::runtime_error if it can't be written
+	void m_save(const std::string &path, const InputFile &input) const
+	{
+		const std::vector<FilterHeader> header = {{FORMAT_VERSION, static_cast<uint32_t>(BLOCK_SIZE), input.m_size(), input.m_mtime(), p_blocks.size(), FILTER_BITS}};
+		BinaryCache::SectionWriter writer;
+		writer.add(header);
+		writer.add(p_blocks);
+		writer.add(p_filters);
+		writer.save(sidecarPath(path));
+	}
+
+  private:
+	std::vector<trigram::CandidateRange> p_blocks;
+	std::vector<uint64_t> p_filters;
+
+	void p_addFilter(const char *begin, const char *end)
+	{
+		p_filters.resize(p_filters.size() + FILTER_WORDS, 0);
+		uint64_t *filter = p_filters.data() + p_filters.size() - FILTER_WORDS;
+		uint32_t window = 0;
+		unsigned have = 0;
+		uint32_t bits[3];
+		for (const char *p = begin; p < end; ++p)
+		{
+			if (*p == '\n') // queries never span lines
+			{
+				have = 0;
+				continue;
+			}
+			window = ((window << 8) | static_cast<uint8_t>(simd::foldAscii(*p))) & 0xFFFFFF;
+			if (++have < 3)
+				continue;
+			have = 3;
+			trigramBits(window, bits);
+			for (uint32_t bit : bits)
+				filter[bit >> 6] |= uint64_t(1) << (bit & 63);
+		}
+	}
+};
+
+class BlockFilter
+{
+  public:
+	// false when the file has no filters, or they were built from another version of it
+	bool m_open(const std::string &path, const InputFile &input)
+	{
+		try
+		{
+			p_sections = std::make_unique<BinaryCache::MappedSections>(sidecarPath(path));
+			const auto header = p_sections->get<FilterHeader>(0);
+			p_blocks = p_sections->get<trigram::CandidateRange>(1);
+			p_filters = p_sections->get<uint64_t>(2);
+			if (header.size() == 1 && header[0].m_version == FORMAT_VERSION && header[0].m_filter_bits == FILTER_BITS &&
+				header[0].m_file_size == input.m_size() && header[0].m_mtime == input.m_mtime() &&
+				header[0].m_blocks == p_blocks.size() && p_filters.size() == p_blocks.size() * FILTER_WORDS)
+				return true;
+		}
+		catch (const std::exception &)
+		{
+		}
+		p_sections.reset();
+		return false;
+	}
+
+	size_t m_blockCount() const { return p_blocks.size(); }
+
+	/* The blocks that may contain one of "literals", neighbours merged into ranges of up to "max_range" bytes
+	 * (and never more than trigram::MAX_RANGE_SIZE, they're read whole). Returns false when the filters can't
+	 * narrow anything down (no literals, or one shorter than a trigram). */
+	bool m_candidates(const std::vector<std::string> &literals, std::vector<trigram::CandidateRange> &ranges, uint64_t max_range = trigram::MAX_RANGE_SIZE) const
+	{
+		max_range = std::min(max_range, trigram::MAX_RANGE_SIZE);
+		ranges.clear();
+		if (literals.empty())
+			return false;
+		std::vector<std::vector<uint32_t>> needed; // the bits each literal needs set
+		for (const std::string &literal : literals)
+		{
+			if (literal.size() < 3)
+				return false;
+			std::vector<uint32_t> &bits = needed.emplace_back();
+			for (size_t i = 0; i + 3 <= literal.size(); i++)
+			{
+				uint32_t three[3];
+				trigramBits(trigram::pack(literal[i], literal[i + 1], literal[i + 2]), three);
+				bits.insert(bits.end(), three, three + 3);
+			}
+			std::sort(bits.begin(), bits.end()); // walks the filter front to back
+			bits.erase(std::unique(bits.begin(), bits.end()), bits.end());
+		}
+
+		for (size_t b = 0; b < p_blocks.size(); b++)
+		{
+			const uint64_t *filter = p_filters.data() + b * FILTER_WORDS;
+			const bool candidate = std::any_of(needed.begin(), needed.end(), [&](const std::vector<uint32_t> &bits) {
+				return std::all_of(bits.begin(), bits.end(), [&](uint32_t bit) { return (filter[bit >> 6] >> (bit & 63)) & 1; });
+			});
+			if (!candidate)
+				continue;
+			const trigram::CandidateRange &block = p_blocks[b];
+			if (!ranges.empty() && ranges.back().m_offset + ranges.back().m_length == block.m_offset && ranges.back().m_length + block.m_length <= max_range)
+				ranges.back().m_length += block.m_length;
+			else
+				ranges.push_back(block);
+		}
+		return true;
+	}
+
+  private:
+	std::unique_ptr<BinaryCache::MappedSections> p_sections;
+	std::span<const trigram::CandidateRange> p_blocks;
+	std::span<const uint64_t> p_filters;
+};
+
+// report(const ScanHit &) -> bool like LineSearcher, over the candidate ranges only
+template <typename Report>
+bool searchRanges(InputFile &input, const std::vector<trigram::CandidateRange> &ranges, const Matcher &matcher, Report &&report)
+{
+	return trigram::forEachRange(input, ranges, [&](std::string_view block, uint64_t offset, uint64_t first_line) -> bool {
+		LineSearcher searcher(matcher, first_line);
+		return searcher.m_searchBlock(block, offset, report);
+	});
+}
+
+// the same on "threads" threads, a range per chunk. report is called from the calling thread, in file order
+template <typename Report>
+bool searchRanges(InputFile &input, const std::vector<trigram::CandidateRange> &ranges, const Matcher &matcher, unsigned threads, Report &&report)
+{
+	auto search = [&](size_t index, const Matcher &chunk_matcher, parallel::ChunkResult &, auto &collect) -> bool {
+		std::string_view block;
+		if (!trigram::readRange(input, ranges[index], block))
+			return false;
+		LineSearcher searcher(chunk_matcher, ranges[index].m_first_line); // real line numbers already, m_newlines stays 0
+		searcher.m_searchBlock(block, ranges[index].m_offset, collect);
+		return true;
+	};
+	return parallel::searchChunks(ranges.size(), matcher, threads, 0, search, report);
+}
+
+// -c/-l/-q over the candidate ranges on "threads" threads
+inline bool countRanges(InputFile &input, const std::vector<trigram::CandidateRange> &ranges, const Matcher &matcher, unsigned threads, uint64_t limit, uint64_t &count)
+{
+	return parallel::countChunks(ranges.size(), matcher, threads, limit, count, [&](size_t index, auto &&fn) -> bool {
+		std::string_view block;
+		if (!trigram::readRange(input, ranges[index], block))
+			return false;
+		fn(block);
+		return true;
+	});
+}
+
+/* A normal scan of the whole file that builds its filters on the way. They're only saved when the scan
+ * got to the end (not cut short by -m/-q), failing to save them (read-only directory...) isn't an error. */
+template <typename Report>
+bool searchAndBuild(const std::string &path, InputFile &input, const Matcher &matcher, Report &&report)
+{
+	FilterBuilder builder;
+	LineSearcher searcher(matcher);
+	bool complete = true;
+	const bool ok = scanner::forEachBlock(input, [&](std::string_view block, uint64_t offset) -> bool {
+		builder.m_add(block, offset, searcher.m_lineNumber());
+		complete = searcher.m_searchBlock(block, offset, report);
+		return complete;
+	});
+	if (ok && complete)
+	{
+		try
+		{
+			builder.m_save(path, input);
+		}
+		catch (const std::exception &)
+		{
+		}
+	}
+	return ok;
+}
+} // namespace blockfilter
+
+#endif // blockfilter.hpp
@@ -0,0 +1,635 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef DECOMPRESS_HPP
+#define DECOMPRESS_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "stats.hpp"
+
+/* .gz and .zst files are searched without a temp file: one thread decompresses into a ring of buffers
+ * while the calling thread scans the buffer before. Whole lines are put back together across buffer
+ * (and gzip member / zstd frame) boundaries, so the scanner sees the same blocks of lines as for a plain file.
+ * With -j N, files whose members can be found without decompressing them (zstd frames, BGZF gzip
+ * like bgzip writes) get their members decompressed on N threads at once.
+ * zlib is linked in. libzstd is loaded at runtime when the first .zst shows up, a box without it
+ * only loses .zst support. */
+
+namespace decompress
+{
+enum class Compression
+{
+	none,
+	gzip,
+	zstd,
+};
+
+constexpr size_t RING_BUFFERS = 4;
+constexpr size_t RING_BUFFER_SIZE = size_t(1) << 20;
+constexpr size_t INPUT_BUFFER_SIZE = size_t(256) << 10;
+
+inline Compression detect(const unsigned char *magic, size_t length)
+{
+	if (length >= 3 && magic[0] == 0x1F && magic[1] == 0x8B && magic[2] == 8) // 8 = deflate, the only method there is
+		return Compression::gzip;
+	if (length >= 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+		return Compression::zstd;
+	return Compression::none;
+}
+
+namespace detail
+{
+inline unsigned &threadCount()
+{
+	static unsigned threads = 1;
+	return threads;
+}
+
+// the part of the libzstd API we use, its ABI has been stable since 1.0
+struct ZstdInBuffer
+{
+	const void *m_src;
+	size_t m_size;
+	size_t m_pos;
+};
+struct ZstdOutBuffer
+{
+	void *m_dst;
+	size_t m_size;
+	size_t m_pos;
+};
+
+struct Zstd
+{
+	void *(*m_createDStream)() = nullptr;
+	size_t (*m_freeDStream)(void *) = nullptr;
+	size_t (*m_decompressStream)(void *, ZstdOutBuffer *, ZstdInBuffer *) = nullptr;
+	unsigned (*m_isError)(size_t) = nullptr;
+	size_t (*m_findFrameCompressedSize)(const void *, size_t) = nullptr;
+	bool m_loaded = false;
+};
+
+inline const Zstd &zstd()
+{
+	static const Zstd api = []() {
+		Zstd loaded;
+		void *library = ::dlopen("libzstd.so.1", RTLD_NOW | RTLD_LOCAL);
+		if (library == nullptr)
+			library = ::dlopen("libzstd.so", RTLD_NOW | RTLD_LOCAL);
+		if (library == nullptr)
+			return loaded;
+		auto symbol = [&](auto &function, const char *name) {
+			function = reinterpret_cast<std::remove_reference_t<decltype(function)>>(::dlsym(library, name));
+			return function != nullptr;
+		};
+		loaded.m_loaded = symbol(loaded.m_createDStream, "ZSTD_createDStream") && symbol(loaded.m_freeDStream, "ZSTD_freeDStream") &&
+						  symbol(loaded.m_decompressStream, "ZSTD_decompressStream") && symbol(loaded.m_isError, "ZSTD_isError") &&
+						  symbol(loaded.m_findFrameCompressedSize, "ZSTD_findFrameCompressedSize");
+		return loaded;
+	}();
+	return api;
+}
+} // namespace detail
+
+// Threads for decompressing independent members of one file (the -j of a single file search)
+inline void setThreads(unsigned threads)
+{
+	detail::threadCount() = std::max(threads, 1u);
+}
+
+inline bool isAvailable(Compression compression)
+{
+	return compression != Compression::zstd || detail::zstd().m_loaded;
+}
+
+// A decompressed stream, pulled a buffer at a time. m_read gives 0 bytes at the end and false on corrupt or truncated data
+class Decoder
+{
+  public:
+	virtual ~Decoder() = default;
+	virtual bool m_read(char *out, size_t capacity, size_t &produced) = 0;
+};
+
+// Pulls compressed bytes from an fd, or hands out a block that's already in memory
+class CompressedInput
+{
+  public:
+	explicit CompressedInput(int fd) : p_fd(fd), p_buffer(INPUT_BUFFER_SIZE) {}
+	explicit CompressedInput(std::string_view data) : p_data(data) {}
+
+	// the next bytes, empty at the end. false on a read error
+	bool m_next(std::string_view &chunk)
+	{
+		if (p_fd < 0)
+		{
+			chunk = p_data;
+			p_data = {};
+			return true;
+		}
+		for (;;)
+		{
+			const ssize_t n = ::read(p_fd, p_buffer.data(), p_buffer.size());
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n < 0)
+				return false;
+			chunk = std::string_view(p_buffer.data(), static_cast<size_t>(n));
+			return true;
+		}
+	}
+
+  private:
+	int p_fd = -1;
+	std::vector<char> p_buffer;
+	std::string_view p_data;
+};
+
+// gzip, including files made of several members (cat a.gz b.gz, or bgzip)
+class GzipDecoder : public Decoder
+{
+  public:
+	explicit GzipDecoder(CompressedInput input) : p_input(std::move(input))
+	{
+		p_ok = inflateInit2(&p_stream, 16 + MAX_WBITS) == Z_OK;
+	}
+	~GzipDecoder() override { inflateEnd(&p_stream); }
+
+	bool m_read(char *out, size_t capacity, size_t &produced) override
+	{
+		produced = 0;
+		p_stream.next_out = reinterpret_cast<Bytef *>(out);
+		p_stream.avail_out = static_cast<uInt>(std::min<size_t>(capacity, UINT32_MAX));
+		while (p_ok && !p_done && p_stream.avail_out > 0)
+		{
+			if (p_stream.avail_in == 0)
+			{
+				std::string_view chunk;
+				if (!p_input.m_next(chunk))
+					return false;
+				if (chunk.empty())
+				{
+					p_done = true;
+					p_ok = p_between_members; // ending in the middle of a member means it was cut off
+					break;
+				}
+				p_stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(chunk.data()));
+				p_stream.avail_in = static_cast<uInt>(chunk.size());
+			}
+			if (p_between_members)
+			{
+				if (p_stream.next_in[0] != 0x1F) // trailing zeros or junk after the last member, gzip ignores it too
+				{
+					p_done = true;
+					break;
+				}
+				p_between_members = false;
+			}
+
+			const int result = inflate(&p_stream, Z_NO_FLUSH);
+			if (result == Z_STREAM_END)
+			{
+				inflateReset(&p_stream); // another member may follow
+				p_between_members = true;
+			}
+			else if (result != Z_OK && result != Z_BUF_ERROR)
+				p_ok = false;
+		}
+		produced = capacity - p_stream.avail_out;
+		return p_ok;
+	}
+
+  private:
+	CompressedInput p_input;
+	z_stream p_stream = {};
+	bool p_ok = false;
+	bool p_done = false;
+	bool p_between_members = false;
+};
+
+class ZstdDecoder : public Decoder
+{
+  public:
+	explicit ZstdDecoder(CompressedInput input) : p_input(std::move(input))
+	{
+		if (detail::zstd().m_loaded)
+			p_stream = detail::zstd().m_createDStream();
+	}
+	~ZstdDecoder() override
+	{
+		if (p_stream != nullptr)
+			detail::zstd().m_freeDStream(p_stream);
+	}
+
+	bool m_read(char *out, size_t capacity, size_t &produced) override
+	{
+		const detail::Zstd &api = detail::zstd();
+		detail::ZstdOutBuffer output = {out, capacity, 0};
+		while (p_stream != nullptr && !p_done && output.m_pos < output.m_size)
+		{
+			if (p_in.m_pos == p_in.m_size)
+			{
+				std::string_view chunk;
+				if (!p_input.m_next(chunk))
+					return false;
+				if (chunk.empty())
+				{
+					p_done = true;
+					break;
+				}
+				p_in = {chunk.data(), chunk.size(), 0};
+			}
+			p_pending = api.m_decompressStream(p_stream, &output, &p_in);
+			if (api.m_isError(p_pending))
+				p_stream_error = true;
+			if (p_stream_error)
+				break;
+		}
+		produced = output.m_pos;
+		// at the end, anything but a finished frame means the file was cut off
+		return p_stream != nullptr && !p_stream_error && !(p_done && p_pending != 0);
+	}
+
+  private:
+	CompressedInput p_input;
+	void *p_stream = nullptr;
+	detail::ZstdInBuffer p_in = {nullptr, 0, 0};
+	size_t p_pending = 0; // what decompressStream returned last, 0 = a frame just ended
+	bool p_done = false;
+	bool p_stream_error = false;
+};
+
+inline std::unique_ptr<Decoder> makeDecoder(Compression compression, CompressedInput input)
+{
+	if (compression == Compression::gzip)
+		return std::make_unique<GzipDecoder>(std::move(input));
+	return std::make_unique<ZstdDecoder>(std::move(input));
+}
+
+// Decompressed bytes in, blocks of whole lines out: fn(std::string_view block, uint64_t offset) -> bool
+template <typename Fn>
+class LineAssembler
+{
+  public:
+	explicit LineAssembler(Fn &fn) : p_fn(fn) {}
+
+	bool m_push(std::string_view chunk)
+	{
+		if (!p_carry.empty())
+		{
+			const char *newline = static_cast<const char *>(std::memchr(chunk.data(), '\n', chunk.size()));
+			if (newline == nullptr)
+			{
+				p_carry.append(chunk);
+				return true;
+			}
+			// the line that straddles the boundary becomes a block of its own
+			const size_t head = static_cast<size_t>(newline + 1 - chunk.data());
+			p_carry.append(chunk.substr(0, head));
+			if (!p_emit(p_carry))
+				return false;
+			p_carry.clear();
+			chunk.remove_prefix(head);
+		}
+		const char *newline = static_cast<const char *>(::memrchr(chunk.data(), '\n', chunk.size()));
+		const size_t whole = newline == nullptr ? 0 : static_cast<size_t>(newline + 1 - chunk.data());
+		if (whole > 0 && !p_emit(chunk.substr(0, whole)))
+			return false;
+		p_carry.append(chunk.substr(whole));
+		return true;
+	}
+
+	bool m_finish() // the last line, when the text doesn't end with '\n'
+	{
+		return p_carry.empty() || p_emit(p_carry);
+	}
+
+  private:
+	Fn &p_fn;
+	std::string p_carry;
+	uint64_t p_offset = 0;
+
+	bool p_emit(std::string_view block)
+	{
+		const bool go_on = p_fn(block, p_offset);
+		p_offset += block.size();
+		return go_on;
+	}
+};
+
+/* Fixed set of buffers handed back and forth between one producer and one consumer, in order.
+ * Either side can cancel, the other one then stops waiting. */
+class BufferRing
+{
+  public:
+	BufferRing(size_t buffers, size_t size) : p_buffers(buffers, std::vector<char>(size)), p_lengths(buffers, 0) {}
+
+	// the next buffer to fill, nullptr once cancelled
+	std::vector<char> *m_acquire()
+	{
+		std::unique_lock<std::mutex> lock(p_mutex);
+		p_space.wait(lock, [&] { return p_cancelled || p_produced - p_consumed < p_buffers.size(); });
+		return p_cancelled ? nullptr : &p_buffers[p_produced % p_buffers.size()];
+	}
+
+	void m_publish(size_t length, bool last)
+	{
+		{
+			std::lock_guard<std::mutex> lock(p_mutex);
+			p_lengths[p_produced % p_buffers.size()] = length;
+			p_produced++;
+			p_finished = last;
+		}
+		p_data.notify_one();
+	}
+
+	// the next filled buffer, false when there's none left (or cancelled)
+	bool m_next(std::string_view &data)
+	{
+		std::unique_lock<std::mutex> lock(p_mutex);
+		p_data.wait(lock, [&] { return p_cancelled || p_consumed < p_produced || p_finished; });
+		if (p_cancelled || p_consumed == p_produced)
+			return false;
+		const size_t slot = p_consumed % p_buffers.size();
+		data = std::string_view(p_buffers[slot].data(), p_lengths[slot]);
+		return true;
+	}
+
+	void m_release()
+	{
+		{
+			std::lock_guard<std::mutex> lock(p_mutex);
+			p_consumed++;
+		}
+		p_space.notify_one();
+	}
+
+	void m_cancel()
+	{
+		{
+			std::lock_guard<std::mutex> lock(p_mutex);
+			p_cancelled = true;
+		}
+		p_space.notify_all();
+		p_data.notify_all();
+	}
+
+  private:
+	std::vector<std::vector<char>> p_buffers;
+	std::vector<size_t> p_lengths;
+	size_t p_produced = 0;
+	size_t p_consumed = 0;
+	bool p_finished = false;
+	bool p_cancelled = false;
+	std::mutex p_mutex;
+	std::condition_variable p_space, p_data;
+};
+
+// Decompresses the start of "compressed" into out, for a look at the first bytes of text. Returns how much there was
+inline size_t peek(std::string_view compressed, Compression compression, char *out, size_t capacity)
+{
+	if (!isAvailable(compression))
+		return 0;
+	std::unique_ptr<Decoder> decoder = makeDecoder(compression, CompressedInput(compressed));
+	size_t filled = 0;
+	while (filled < capacity)
+	{
+		size_t produced = 0;
+		const bool ok = decoder->m_read(out + filled, capacity - filled, produced); // only a cut off piece of the file, the end is never clean
+		filled += produced;
+		if (!ok || produced == 0)
+			break;
+	}
+	return filled;
+}
+
+/* Where the members of a file start, when that can be known without decompressing anything:
+ * zstd frames carry their compressed size, BGZF gzip members their BSIZE in the header's extra field.
+ * Plain gzip members can only be found by inflating the one before, false then. */
+inline bool splitMembers(std::string_view data, Compression compression, std::vector<std::string_view> &members)
+{
+	members.clear();
+	while (!data.empty())
+	{
+		size_t size = 0;
+		if (compression == Compression::zstd)
+		{
+			size = detail::zstd().m_findFrameCompressedSize(data.data(), data.size());
+			if (detail::zstd().m_isError(size))
+				return false;
+		}
+		else
+		{
+			// ID1 ID2 CM FLG MTIME(4) XFL OS XLEN(2), then the "BC" subfield with BSIZE = member size - 1
+			const auto *bytes = reinterpret_cast<const unsigned char *>(data.data());
+			if (data.size() < 18 || bytes[0] != 0x1F || bytes[1] != 0x8B || (bytes[3] & 0x04) == 0 ||
+				bytes[12] != 'B' || bytes[13] != 'C' || bytes[14] != 2 || bytes[15] != 0)
+				return false;
+			size = static_cast<size_t>(bytes[16] | (bytes[17] << 8)) + 1;
+		}
+		if (size == 0 || size > data.size())
+			return false;
+		members.push_back(data.substr(0, size));
+		data.remove_prefix(size);
+	}
+	return members.size() > 1;
+}
+
+namespace detail
+{
+// members decompressed on "threads" threads, at most 2 per thread in flight, handed to the assembler in order
+template <typename Assembler>
+bool forEachMemberParallel(const std::vector<std::string_view> &members, Compression compression, unsigned threads, Assembler &assembler)
+{
+	const size_t window = static_cast<size_t>(threads) * 2;
+	struct Slot
+	{
+		std::string m_text;
+		bool m_ready = false;
+		bool m_ok = true;
+	};
+	std::vector<Slot> slots(window);
+	std::mutex mutex;
+	std::condition_variable changed;
+	size_t next = 0, consumed = 0;
+	bool cancelled = false;
+
+	auto work = [&]() {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;)
+		{
+			changed.wait(lock, [&] { return cancelled || next == members.size() || next < consumed + window; });
+			if (cancelled || next == members.size())
+				return;
+			const size_t member = next++;
+			lock.unlock();
+
+			std::string text;
+			std::unique_ptr<Decoder> decoder = makeDecoder(compression, CompressedInput(members[member]));
+			bool ok = true;
+			size_t step = std::max<size_t>(members[member].size() * 4, size_t(64) << 10); // text usually compresses 3-5x
+			for (;;)
+			{
+				const size_t used = text.size();
+				text.resize(used + step);
+				size_t produced = 0;
+				{
+					profiler::Scope<stats::Zone::read> zone;
+					ok = decoder->m_read(text.data() + used, step, produced);
+					zone.m_addBytes(produced);
+				}
+				text.resize(used + produced);
+				if (!ok || produced == 0)
+					break;
+				step = std::max(step, text.size());
+			}
+
+			lock.lock();
+			Slot &slot = slots[member % window];
+			slot.m_text = std::move(text);
+			slot.m_ok = ok;
+			slot.m_ready = true;
+			changed.notify_all();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned i = 0; i < threads; i++)
+		workers.emplace_back(work);
+
+	bool ok = true;
+	for (size_t member = 0; member < members.size() && ok; member++)
+	{
+		Slot &slot = slots[member % window];
+		std::string text;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&] { return slot.m_ready; });
+			text = std::move(slot.m_text);
+			ok = slot.m_ok;
+			slot = Slot{};
+			consumed++;
+		}
+		changed.notify_all();
+		ok = ok && assembler.m_push(text);
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		cancelled = true;
+	}
+	changed.notify_all();
+	for (auto &worker : workers)
+		worker.join();
+	return ok;
+}
+} // namespace detail
+
+/* fn(std::string_view block, uint64_t offset) -> bool over the decompressed text of fd, like
+ * scanner::forEachBufferedBlock (offsets are in the decompressed text). Returns false on a read
+ * error or corrupt/truncated data, what was decompressed before that has been scanned. */
+template <typename Fn>
+bool forEachBlock(int fd, uint64_t size, Compression compression, Fn &&fn)
+{
+	if (!isAvailable(compression))
+		return false;
+	bool completed = true; // false once fn said stop
+	auto tracked = [&](std::string_view block, uint64_t offset) -> bool {
+		completed = fn(block, offset);
+		return completed;
+	};
+	LineAssembler<decltype(tracked)> assembler(tracked);
+
+	// independent members: decompress several at once
+	const unsigned threads = detail::threadCount();
+	if (threads > 1 && size > 0)
+	{
+		void *addr = ::mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr != MAP_FAILED)
+		{
+			std::vector<std::string_view> members;
+			const bool split = splitMembers(std::string_view(static_cast<const char *>(addr), static_cast<size_t>(size)), compression, members);
+			bool ok = true;
+			if (split)
+				ok = detail::forEachMemberParallel(members, compression, threads, assembler) && (!completed || assembler.m_finish());
+			::munmap(addr, static_cast<size_t>(size));
+			if (split)
+				return ok || !completed;
+		}
+	}
+
+	// one thread decompresses ahead into the ring, this one scans
+	BufferRing ring(RING_BUFFERS, RING_BUFFER_SIZE);
+	std::atomic<bool> decoded_ok{true};
+	std::thread producer([&]() {
+		std::unique_ptr<Decoder> decoder = makeDecoder(compression, CompressedInput(fd));
+		for (;;)
+		{
+			std::vector<char> *buffer = ring.m_acquire();
+			if (buffer == nullptr)
+				return; // the scan stopped early
+			size_t filled = 0;
+			bool last = false;
+			while (filled < buffer->size())
+			{
+				size_t produced = 0;
+				bool read_ok;
+				{
+					profiler::Scope<stats::Zone::read> zone;
+					read_ok = decoder->m_read(buffer->data() + filled, buffer->size() - filled, produced);
+					zone.m_addBytes(produced);
+				}
+				if (!read_ok)
+				{
+					decoded_ok = false;
+					last = true;
+					break;
+				}
+				if (produced == 0)
+				{
+					last = true;
+					break;
+				}
+				filled += produced;
+			}
+			ring.m_publish(filled, last);
+			if (last)
+				return;
+		}
+	});
+
+	std::string_view data;
+	while (ring.m_next(data))
+	{
+		const bool go_on = assembler.m_push(data);
+		ring.m_release();
+		if (!go_on)
+		{
+			ring.m_cancel();
+			break;
+		}
+	}
+	producer.join();
+	if (completed)
+		assembler.m_finish();
+	return decoded_ok || !completed;
+}
+} // namespace decompress
+
+#endif // decompress.hpp
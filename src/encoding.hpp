@@ -0,0 +1,373 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef ENCODING_HPP
+#define ENCODING_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+
+#include "matcher.hpp"
+#include "scanner.hpp"
+#include "decompress.hpp"
+#include "stats.hpp"
+#include "../libutils/src/simd.hpp"
+#include "../libutils/src/utf8.hpp"
+
+/* UTF-16 files (Windows logs mostly) are searched in UTF-16: the patterns' literals are transcoded once and
+ * looked for in the raw bytes with the usual engines, only hits that start on a unit boundary count.
+ * Lines end on the newline unit (0A 00 in LE, 00 0A in BE), not on every 0x0A byte.
+ * A plain search (no -e, no -i) is done once the literal is found, anything else gets the candidate
+ * line transcoded to UTF-8 and checked with the normal matcher, which is also what prints it.
+ * A file is UTF-16 when it starts with a BOM, or when --encoding says so. */
+
+namespace encoding
+{
+enum class Encoding
+{
+	automatic, // bytes, unless there's a UTF-16 BOM
+	utf8,	   // bytes, with invalid sequences printed as U+FFFD
+	utf16le,
+	utf16be,
+};
+
+inline bool parseEncoding(std::string_view name, Encoding &encoding)
+{
+	if (name == "auto")
+		encoding = Encoding::automatic;
+	else if (name == "utf8" || name == "utf-8")
+		encoding = Encoding::utf8;
+	else if (name == "utf16le" || name == "utf-16le")
+		encoding = Encoding::utf16le;
+	else if (name == "utf16be" || name == "utf-16be")
+		encoding = Encoding::utf16be;
+	else
+		return false;
+	return true;
+}
+
+inline bool isUtf16(Encoding encoding) { return encoding == Encoding::utf16le || encoding == Encoding::utf16be; }
+
+// what "input" gets searched as, a BOM only counts when nothing was asked for
+inline Encoding detect(const InputFile &input, Encoding requested)
+{
+	if (requested != Encoding::automatic)
+		return requested;
+	char text[2];
+	std::string_view head = input.m_head();
+	if (input.m_compression() != decompress::Compression::none)
+		head = std::string_view(text, decompress::peek(head, input.m_compression(), text, sizeof(text)));
+	if (head.size() < 2)
+		return requested;
+	const auto first = static_cast<unsigned char>(head[0]), second = static_cast<unsigned char>(head[1]);
+	if (first == 0xFF && second == 0xFE)
+		return Encoding::utf16le;
+	if (first == 0xFE && second == 0xFF)
+		return Encoding::utf16be;
+	return requested;
+}
+
+//########################################################
+// UTF-16 lines
+
+// "\n" as a unit loaded from memory, like simd::countUnits16 wants it
+inline uint16_t newlineUnit(bool big_endian) { return big_endian ? 0x0A00 : 0x000A; }
+
+inline bool startsWithBom(const char *p, const char *end, bool big_endian)
+{
+	return end - p >= 2 && static_cast<unsigned char>(p[0]) == (big_endian ? 0xFE : 0xFF) && static_cast<unsigned char>(p[1]) == (big_endian ? 0xFF : 0xFE);
+}
+
+// first newline unit in [p, end), p is on a unit boundary. memchr finds the 0x0A byte, the rest is checked around it
+inline const char *findNewline(const char *p, const char *end, bool big_endian)
+{
+	const char *q = p + big_endian; // where the 0x0A byte of a unit at p would be
+	while (q < end)
+	{
+		q = static_cast<const char *>(std::memchr(q, '\n', static_cast<size_t>(end - q)));
+		if (q == nullptr)
+			return nullptr;
+		const char *unit = q - big_endian;
+		if (((unit - p) & 1) == 0 && unit + 2 <= end && unit[!big_endian] == '\0')
+			return unit;
+		q++;
+	}
+	return nullptr;
+}
+
+// last newline unit in [p, end) that's complete, p is on a unit boundary
+inline const char *findLastNewline(const char *p, const char *end, bool big_endian)
+{
+	const char *q = end;
+	while (q > p)
+	{
+		q = static_cast<const char *>(::memrchr(p, '\n', static_cast<size_t>(q - p)));
+		if (q == nullptr)
+			return nullptr;
+		const char *unit = q - big_endian;
+		if (unit >= p && ((unit - p) & 1) == 0 && unit + 2 <= end && unit[!big_endian] == '\0')
+			return unit;
+	}
+	return nullptr;
+}
+
+// Finds matching UTF-16 lines, shared by every thread (the matcher that verifies lines is passed in, it can have state)
+class Utf16Matcher
+{
+  public:
+	// "exact": a hit of the literals is a match by itself (no -e, no -i)
+	Utf16Matcher(const Matcher &matcher, bool big_endian, bool exact, bool case_insensitive)
+		: p_big_endian(big_endian), p_exact(exact)
+	{
+		std::vector<std::string> literals = matcher.m_requiredLiterals();
+		for (std::string &literal : literals)
+		{
+			if (!utf8::isValid(literal)) // a piece of a character (a regex class of multibyte ones), only whole lines can be checked
+			{
+				literals.clear();
+				break;
+			}
+			std::string units;
+			utf8::appendUtf16(literal, big_endian, units);
+			literal = std::move(units);
+		}
+		if (!literals.empty())
+			p_prefilter = makeMatcher(literals, case_insensitive);
+		p_exact = exact && p_prefilter != nullptr;
+	}
+
+	bool m_bigEndian() const { return p_big_endian; }
+
+	/* The first matching line in [begin, end), begin is the start of a line. Returns where the line starts and
+	 * sets line_end to its newline unit (or end), nullptr if no line matches. "text" is scratch space.
+	 * Without need_start it can return any unit of the line instead, which saves going back to its start for -c */
+	const char *m_findLine(const Matcher &verify, const char *begin, const char *end, const char *&line_end, std::string &text, bool need_start = true) const
+	{
+		const char *p = begin; // start of the line the next hit can be in
+		const char *from = begin;
+		while (p < end)
+		{
+			const char *hit = p;
+			if (p_prefilter != nullptr)
+			{
+				hit = p_prefilter->m_find(from, end);
+				if (hit == nullptr)
+					return nullptr;
+				if (p_exact && ((hit - p) & 1) != 0) // the bytes of two neighbouring units, not a match
+				{
+					from = hit + 1;
+					continue;
+				}
+				hit = p + ((hit - p) & ~static_cast<ptrdiff_t>(1));
+			}
+
+			line_end = findNewline(hit, end, p_big_endian);
+			if (line_end == nullptr)
+				line_end = end;
+			if (p_exact && !need_start)
+				return hit;
+			const char *newline = findLastNewline(p, hit, p_big_endian);
+			const char *line = newline != nullptr ? newline + 2 : p;
+			if (p_exact)
+				return line;
+
+			text.clear();
+			utf8::appendFromUtf16(line, static_cast<size_t>(line_end - line), p_big_endian, text);
+			text += '\n'; // a block of one whole line, an empty one included
+			if (verify.m_find(text.data(), text.data() + text.size()) != nullptr)
+				return line;
+			p = from = (line_end < end) ? line_end + 2 : end;
+		}
+		return nullptr;
+	}
+
+  private:
+	std::unique_ptr<Matcher> p_prefilter; // the literals in UTF-16, nullptr when there are none (every line gets verified)
+	bool p_big_endian;
+	bool p_exact;
+};
+
+// LineSearcher for UTF-16 blocks, the lines it reports are transcoded to UTF-8
+class Utf16LineSearcher
+{
+  public:
+	Utf16LineSearcher(const Utf16Matcher &matcher, const Matcher &verify) : p_matcher(matcher), p_verify(verify) {}
+
+	// report(const ScanHit &) -> bool, returning false stops the search
+	template <typename Report>
+	bool m_searchBlock(std::string_view block, uint64_t block_offset, Report &&report)
+	{
+		profiler::Scope<stats::Zone::match> zone;
+		zone.m_addBytes(block.size());
+		const bool big_endian = p_matcher.m_bigEndian();
+		const char *p = block.data();
+		const char *end = p + block.size();
+		if (block_offset == 0 && startsWithBom(p, end, big_endian)) // not part of the first line
+			p += 2;
+		const char *counted = p;
+
+		// in batches like LineSearcher
+		const char *lines[HIT_BATCH];
+		const char *line_ends[HIT_BATCH];
+		bool more = true;
+		while (more && p < end)
+		{
+			size_t count = 0;
+			while (count < HIT_BATCH && p < end)
+			{
+				const char *line_end;
+				const char *line = p_matcher.m_findLine(p_verify, p, end, line_end, p_scratch);
+				if (line == nullptr)
+				{
+					more = false;
+					break;
+				}
+				lines[count] = line;
+				line_ends[count++] = line_end;
+				p = (line_end < end) ? line_end + 2 : end;
+			}
+			if (count == 0)
+				break;
+
+			{
+				profiler::Scope<stats::Zone::line> line_zone;
+				line_zone.m_countAs(count);
+				for (size_t i = 0; i < count; i++)
+				{
+					p_line_number += simd::countUnits16(counted, lines[i], newlineUnit(big_endian));
+					counted = lines[i];
+					p_hits[i].m_line_number = p_line_number;
+					p_hits[i].m_offset = block_offset + static_cast<uint64_t>(lines[i] - block.data());
+					p_lines[i].clear();
+					utf8::appendFromUtf16(lines[i], static_cast<size_t>(line_ends[i] - lines[i]), big_endian, p_lines[i]);
+					p_hits[i].m_line = p_lines[i];
+					line_zone.m_addBytes(static_cast<uint64_t>(line_ends[i] - lines[i]));
+				}
+			}
+
+			profiler::Scope<stats::Zone::output> output_zone;
+			output_zone.m_countAs(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				if (!report(p_hits[i]))
+					return false;
+			}
+		}
+
+		profiler::Scope<stats::Zone::line> line_zone;
+		p_line_number += simd::countUnits16(counted, end, newlineUnit(big_endian));
+		return true;
+	}
+
+  private:
+	const Utf16Matcher &p_matcher;
+	const Matcher &p_verify;
+	static constexpr size_t HIT_BATCH = LineSearcher::HIT_BATCH;
+
+	uint64_t p_line_number = 1;
+	ScanHit p_hits[HIT_BATCH] = {};
+	std::string p_lines[HIT_BATCH]; // the reported lines in UTF-8
+	std::string p_scratch;			// lines being verified
+};
+
+/* scanner::forEachBlock cuts blocks after a 0x0A byte, which can be half a unit or not a newline at all.
+ * This cuts them again after the last newline unit and carries the rest over to the next block, so
+ * fn(std::string_view block, uint64_t block_offset) -> bool always gets whole UTF-16 lines starting at an even offset.
+ * Only the line that spans two blocks gets copied. */
+template <typename Fn>
+bool forEachBlock(InputFile &input, bool big_endian, Fn &&fn)
+{
+	static thread_local std::string carry; // the unfinished line, starts at carry_offset
+	carry.clear();
+	uint64_t carry_offset = 0;
+	bool stopped = false;
+
+	const bool ok = scanner::forEachBlock(input, [&](std::string_view block, uint64_t offset) -> bool {
+		const char *p = block.data();
+		const char *end = p + block.size();
+		if (!carry.empty())
+		{
+			// finish the carried line: its newline unit can start on the last carried byte
+			const char *rest = nullptr;
+			if ((carry.size() & 1) != 0 && p < end)
+			{
+				const char first = carry.back(), second = *p;
+				if (big_endian ? (first == '\0' && second == '\n') : (first == '\n' && second == '\0'))
+					rest = p + 1;
+			}
+			if (rest == nullptr)
+			{
+				const char *newline = findNewline(p + (carry.size() & 1), end, big_endian);
+				if (newline == nullptr)
+				{
+					carry.append(p, static_cast<size_t>(end - p));
+					return true;
+				}
+				rest = newline + 2;
+			}
+			carry.append(p, static_cast<size_t>(rest - p));
+			if (!fn(std::string_view(carry), carry_offset))
+				return !(stopped = true);
+			p = rest;
+			carry.clear();
+		}
+
+		const uint64_t p_offset = offset + static_cast<uint64_t>(p - block.data());
+		const char *last = findLastNewline(p, end, big_endian);
+		const char *cut = last != nullptr ? last + 2 : p;
+		if (cut > p && !fn(std::string_view(p, static_cast<size_t>(cut - p)), p_offset))
+			return !(stopped = true);
+		carry.assign(cut, static_cast<size_t>(end - cut));
+		carry_offset = p_offset + static_cast<uint64_t>(cut - p);
+		return true;
+	});
+	if (ok && !stopped && !carry.empty())
+		fn(std::string_view(carry), carry_offset);
+	return ok;
+}
+
+template <typename Report>
+bool searchFile(InputFile &input, const Utf16Matcher &matcher, const Matcher &verify, Report &&report)
+{
+	Utf16LineSearcher searcher(matcher, verify);
+	return forEachBlock(input, matcher.m_bigEndian(), [&](std::string_view block, uint64_t offset) -> bool {
+		return searcher.m_searchBlock(block, offset, report);
+	});
+}
+
+// like scanner::countMatches, reading stops once "limit" lines matched or stop() -> bool says so
+template <typename Stop>
+bool countMatches(InputFile &input, const Utf16Matcher &matcher, const Matcher &verify, uint64_t limit, uint64_t &count, Stop &&stop)
+{
+	count = 0;
+	if (limit == 0)
+		return true;
+	std::string scratch;
+	return forEachBlock(input, matcher.m_bigEndian(), [&](std::string_view block, uint64_t offset) -> bool {
+		profiler::Scope<stats::Zone::match> zone;
+		zone.m_addBytes(block.size());
+		const char *p = block.data();
+		const char *end = p + block.size();
+		if (offset == 0 && startsWithBom(p, end, matcher.m_bigEndian()))
+			p += 2;
+		while (p < end && count < limit)
+		{
+			const char *line_end;
+			if (matcher.m_findLine(verify, p, end, line_end, scratch, false) == nullptr)
+				break;
+			count++;
+			if (stop())
+				break;
+			p = (line_end < end) ? line_end + 2 : end;
+		}
+		return count < limit && !stop();
+	});
+}
+} // namespace encoding
+
+#endif // encoding.hpp
@@ -0,0 +1,1039 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef INDEX_HPP
+#define INDEX_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <unordered_map>
+#include <unordered_set>
+#include <span>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scanner.hpp"
+#include "encoding.hpp"
+#include "walker.hpp"
+#include "workpool.hpp"
+#include "../libutils/src/simd.hpp"
+#include "../libutils/src/binarycache.hpp"
+#include "../libutils/src/file.hpp"
+
+/* On-disk trigram index for a directory that gets searched over and over (txtfind --index DIR).
+ * Files are cut into blocks of whole lines (~128KB), and for every trigram (3 bytes, ASCII folded so
+ * -i can use the same index) the index keeps the sorted list of blocks that contain it.
+ * A query takes the literals every match has to contain (Matcher::m_requiredLiterals), intersects
+ * the posting lists of their trigrams and only reads and searches the blocks that survive.
+ *
+ * The index is a stack of segments (LSM style), DIR/.txtfind-index is the manifest listing them oldest first.
+ * The first --index DIR writes one segment with everything, after that --index DIR only re-tokenizes the
+ * files whose size or mtime changed and writes them (plus tombstones for deleted files) as a new small
+ * segment on top. A file's entry in a newer segment hides the older ones. Small segments get merged
+ * together (and eventually into the big one) on a background thread, without reading any file again.
+ * Segments are never modified: the manifest is replaced with a rename and a query mmaps the manifest and
+ * its segments, so it keeps a consistent snapshot no matter what a writer does meanwhile.
+ *
+ * Every segment sits in one BinaryCache section file that is mmap'd as is, nothing gets parsed on load:
+ *   0 header, 1 paths (relative to DIR, one string after the other), 2 files, 3 blocks,
+ *   4 posting lists (sorted by trigram), 5 postings (block id deltas as LEB128 varints) */
+
+namespace trigram
+{
+constexpr const char *INDEX_NAME = ".txtfind-index";
+constexpr size_t BLOCK_SIZE = size_t(128) << 10;
+constexpr uint64_t MAX_RANGE_SIZE = uint64_t(4) << 20; // neighbouring candidate blocks merged into one read, bounds every thread's read buffer
+constexpr uint32_t FORMAT_VERSION = 2;
+constexpr size_t MAX_SEGMENTS = 8;	 // more than that and the newest ones get merged no matter what
+constexpr uint64_t MERGE_RATIO = 4; // a segment joins a merge unless it's over 4x the size of the newer ones being merged
+constexpr uint32_t FILE_DELETED = 1; // IndexedFile::m_flags, a tombstone hiding the file in older segments
+
+struct IndexHeader
+{
+	uint32_t m_version;
+	uint32_t m_block_size;
+	uint64_t m_files;
+	uint64_t m_blocks;
+	uint64_t m_trigrams;
+};
+
+struct IndexedFile
+{
+	uint64_t m_path_offset; // into the paths section
+	uint64_t m_size;
+	int64_t m_mtime;
+	uint32_t m_path_length;
+	uint32_t m_first_block;
+	uint32_t m_block_count;
+	uint32_t m_flags;
+};
+
+struct IndexedBlock
+{
+	uint64_t m_offset; // byte offset in the file, always the start of a line
+	uint64_t m_length;
+	uint64_t m_first_line;
+	uint32_t m_file;
+	uint32_t m_unused;
+};
+
+struct PostingList
+{
+	uint32_t m_trigram;
+	uint32_t m_count;  // blocks in the list
+	uint64_t m_offset; // into the postings section
+};
+
+// the manifest: a header and the segments, oldest first
+struct ManifestHeader
+{
+	uint32_t m_version;
+	uint32_t m_unused;
+	uint64_t m_next_segment; // id of the next segment file to write
+};
+
+struct SegmentInfo
+{
+	uint64_t m_id;
+	uint64_t m_files; // entries, tombstones included
+	uint64_t m_bytes; // size of the segment file, what the merge policy looks at
+};
+
+struct CandidateRange // consecutive candidate blocks of a file, read in one go
+{
+	uint64_t m_offset;
+	uint64_t m_length;
+	uint64_t m_first_line;
+};
+
+struct CandidateFile
+{
+	const IndexedFile *m_file;
+	std::string_view m_path; // relative to the indexed directory
+	std::vector<CandidateRange> m_ranges;
+};
+
+struct BuildStats
+{
+	uint64_t m_files = 0;		 // files in the index after the update
+	uint64_t m_added = 0;
+	uint64_t m_changed = 0;
+	uint64_t m_deleted = 0;
+	uint64_t m_blocks = 0;		 // of the segment that was written
+	uint64_t m_trigrams = 0;	 // same
+	uint64_t m_bytes = 0;		 // bytes of text tokenized
+	uint64_t m_index_bytes = 0; // all segments together
+	uint64_t m_segments = 0;
+	bool m_full = false; // built from scratch, no usable index was there
+};
+
+struct MergeStats
+{
+	uint64_t m_merged = 0; // segments that became one
+	uint64_t m_bytes = 0;	 // size of the merged segment
+};
+
+inline std::string indexPath(const std::string &dir) // the manifest
+{
+	return walker::joinPath(dir, INDEX_NAME);
+}
+
+inline std::string segmentPath(const std::string &dir, uint64_t id)
+{
+	return indexPath(dir) + "." + std::to_string(id);
+}
+
+// everything txtfind keeps next to the data (index manifest and segments, the lock, suffix arrays, temporaries) starts with this
+constexpr const char *SIDECAR_PREFIX = ".txtfind-";
+
+inline bool isIndexFile(const std::string &path) // one of those showing up in a directory listing
+{
+	const size_t slash = path.find_last_of('/');
+	return path.compare(slash == std::string::npos ? 0 : slash + 1, std::strlen(SIDECAR_PREFIX), SIDECAR_PREFIX) == 0;
+}
+
+inline void putVarint(std::vector<uint8_t> &out, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint32_t getVarint(const uint8_t *&p)
+{
+	uint32_t value = 0;
+	for (unsigned shift = 0;; shift += 7)
+	{
+		const uint8_t byte = *p++;
+		value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+		if (byte < 0x80)
+			return value;
+	}
+}
+
+inline uint32_t pack(char a, char b, char c)
+{
+	return (static_cast<uint32_t>(static_cast<uint8_t>(simd::foldAscii(a))) << 16) |
+		   (static_cast<uint32_t>(static_cast<uint8_t>(simd::foldAscii(b))) << 8) |
+		   static_cast<uint32_t>(static_cast<uint8_t>(simd::foldAscii(c)));
+}
+
+// The distinct trigrams of one block, a 2^24 bit set dedupes them and only the set bits get cleared after
+class TrigramCollector
+{
+  public:
+	TrigramCollector() : p_bits((size_t(1) << 24) / 64, 0) {}
+
+	// appends the block's trigrams to out: count, then sorted deltas, all varints
+	void m_collect(const char *begin, const char *end, std::vector<uint8_t> &out)
+	{
+		uint32_t window = 0;
+		unsigned have = 0;
+		for (const char *p = begin; p < end; ++p)
+		{
+			if (*p == '\n') // queries never span lines
+			{
+				have = 0;
+				continue;
+			}
+			window = ((window << 8) | static_cast<uint8_t>(simd::foldAscii(*p))) & 0xFFFFFF;
+			if (++have < 3)
+				continue;
+			have = 3;
+			uint64_t &word = p_bits[window >> 6];
+			const uint64_t bit = uint64_t(1) << (window & 63);
+			if ((word & bit) == 0)
+			{
+				word |= bit;
+				p_found.push_back(window);
+			}
+		}
+
+		std::sort(p_found.begin(), p_found.end());
+		putVarint(out, static_cast<uint32_t>(p_found.size()));
+		uint32_t previous = 0;
+		for (uint32_t trigram : p_found)
+		{
+			putVarint(out, trigram - previous);
+			previous = trigram;
+			p_bits[trigram >> 6] = 0;
+		}
+		p_found.clear();
+	}
+
+  private:
+	std::vector<uint64_t> p_bits;
+	std::vector<uint32_t> p_found;
+};
+
+// A file split into index blocks, with the encoded trigram sets of its blocks
+struct FileTrigrams
+{
+	std::string m_path; // relative to the indexed directory
+	uint64_t m_size = 0;
+	int64_t m_mtime = 0;
+	std::vector<IndexedBlock> m_blocks;
+	std::vector<uint8_t> m_trigrams;
+	bool m_ok = false;
+	bool m_deleted = false; // a tombstone, no blocks
+};
+
+inline bool tokenizeFile(const std::string &path, FileTrigrams &result, TrigramCollector &collector)
+{
+	InputFile input;
+	if (!input.m_open(path))
+		return false;
+	result.m_size = input.m_size();
+	result.m_mtime = input.m_mtime();
+
+	uint64_t line = 1;
+	const encoding::Encoding file_encoding = encoding::detect(input, encoding::Encoding::automatic);
+	if (encoding::isUtf16(file_encoding))
+	{
+		// the trigrams of the UTF-8 text, so UTF-16 files are candidates too (they're searched whole, so one block per chunk is enough)
+		const bool big_endian = file_encoding == encoding::Encoding::utf16be;
+		std::string text;
+		result.m_ok = encoding::forEachBlock(input, big_endian, [&](std::string_view block, uint64_t offset) -> bool {
+			text.clear();
+			utf8::appendFromUtf16(block.data(), block.size(), big_endian, text);
+			result.m_blocks.push_back({offset, block.size(), line, 0, 0});
+			collector.m_collect(text.data(), text.data() + text.size(), result.m_trigrams);
+			line += simd::countUnits16(block.data(), block.data() + block.size(), encoding::newlineUnit(big_endian));
+			return true;
+		});
+		return result.m_ok;
+	}
+	result.m_ok = scanner::forEachBlock(input, [&](std::string_view block, uint64_t offset) -> bool {
+		const char *cursor = block.data();
+		const char *end = cursor + block.size();
+		while (cursor < end)
+		{
+			// end the index block on the last '\n' within BLOCK_SIZE, a longer line makes a longer block
+			const char *stop = end;
+			if (static_cast<size_t>(end - cursor) > BLOCK_SIZE)
+			{
+				const char *newline = static_cast<const char *>(::memrchr(cursor, '\n', BLOCK_SIZE));
+				if (newline == nullptr)
+					newline = static_cast<const char *>(std::memchr(cursor + BLOCK_SIZE, '\n', static_cast<size_t>(end - cursor) - BLOCK_SIZE));
+				stop = newline != nullptr ? newline + 1 : end;
+			}
+
+			result.m_blocks.push_back({offset + static_cast<uint64_t>(cursor - block.data()), static_cast<uint64_t>(stop - cursor), line, 0, 0});
+			collector.m_collect(cursor, stop, result.m_trigrams);
+			line += simd::count(cursor, stop, '\n');
+			cursor = stop;
+		}
+		return true;
+	});
+	return result.m_ok;
+}
+
+// tokenizes the files in parallel, biggest first. "relative" are the paths the index stores
+inline std::vector<FileTrigrams> tokenizeFiles(const std::vector<FileEntry> &entries, size_t prefix, unsigned threads)
+{
+	std::vector<FileTrigrams> tokenized(entries.size());
+	WorkStealingPool<size_t> pool(threads);
+	for (size_t i = 0; i < entries.size(); i++)
+		pool.m_push(static_cast<unsigned>(i), i);
+	std::vector<std::unique_ptr<TrigramCollector>> collectors(pool.m_threads());
+	pool.m_run([&](size_t index, unsigned worker) {
+		if (collectors[worker] == nullptr)
+			collectors[worker] = std::make_unique<TrigramCollector>();
+		tokenizeFile(entries[index].m_path, tokenized[index], *collectors[worker]);
+	});
+
+	for (size_t i = 0; i < entries.size(); i++)
+		tokenized[i].m_path = entries[i].m_path.substr(prefix);
+	return tokenized;
+}
+
+// The tables of one segment before they're written
+struct SegmentData
+{
+	std::vector<char> m_paths;
+	std::vector<IndexedFile> m_files;
+	std::vector<IndexedBlock> m_blocks;
+	std::vector<PostingList> m_lists;
+	std::vector<uint8_t> m_postings;
+
+	void m_addFile(std::string_view path, uint64_t size, int64_t mtime, uint32_t flags)
+	{
+		m_files.push_back({m_paths.size(), size, mtime, static_cast<uint32_t>(path.size()), static_cast<uint32_t>(m_blocks.size()), 0, flags});
+		m_paths.insert(m_paths.end(), path.begin(), path.end());
+	}
+
+	void m_addBlock(IndexedBlock block)
+	{
+		block.m_file = static_cast<uint32_t>(m_files.size() - 1);
+		m_blocks.push_back(block);
+		m_files.back().m_block_count++;
+	}
+
+	void m_addList(uint32_t trigram, const std::vector<uint32_t> &blocks) // blocks sorted
+	{
+		m_lists.push_back({trigram, static_cast<uint32_t>(blocks.size()), m_postings.size()});
+		uint32_t previous = 0;
+		for (uint32_t block : blocks)
+		{
+			putVarint(m_postings, block - previous);
+			previous = block;
+		}
+	}
+
+	// throws std::runtime_error if it can't be written
+	void m_save(const std::string &path) const
+	{
+		const std::vector<IndexHeader> header = {{FORMAT_VERSION, static_cast<uint32_t>(BLOCK_SIZE), m_files.size(), m_blocks.size(), m_lists.size()}};
+		BinaryCache::SectionWriter writer;
+		writer.add(header);
+		writer.add(m_paths);
+		writer.add(m_files);
+		writer.add(m_blocks);
+		writer.add(m_lists);
+		writer.add(m_postings);
+		writer.save(path);
+	}
+};
+
+// Turns tokenized files (and tombstones) into a segment, the files get sorted by path
+inline SegmentData invertFiles(std::vector<FileTrigrams> &tokenized)
+{
+	tokenized.erase(std::remove_if(tokenized.begin(), tokenized.end(), [](const FileTrigrams &file) { return !file.m_ok && !file.m_deleted; }), tokenized.end());
+	std::sort(tokenized.begin(), tokenized.end(), [](const FileTrigrams &lhs, const FileTrigrams &rhs) { return lhs.m_path < rhs.m_path; });
+
+	// 1. files and blocks tables, block ids in path order
+	SegmentData segment;
+	for (const auto &file : tokenized)
+	{
+		segment.m_addFile(file.m_path, file.m_size, file.m_mtime, file.m_deleted ? FILE_DELETED : 0);
+		for (const IndexedBlock &block : file.m_blocks)
+			segment.m_addBlock(block);
+	}
+
+	// 2. invert: count per trigram, then fill the lists in block order so every list comes out sorted
+	auto forEachPair = [&](auto &&fn) {
+		uint32_t block = 0;
+		for (const auto &file : tokenized)
+		{
+			const uint8_t *p = file.m_trigrams.data();
+			for (size_t b = 0; b < file.m_blocks.size(); b++, block++)
+			{
+				uint32_t trigram = 0;
+				for (uint32_t n = getVarint(p); n > 0; n--)
+				{
+					trigram += getVarint(p);
+					fn(trigram, block);
+				}
+			}
+		}
+	};
+
+	std::vector<uint32_t> cursor(size_t(1) << 24, 0);
+	uint64_t pairs = 0;
+	forEachPair([&](uint32_t trigram, uint32_t) { cursor[trigram]++, pairs++; });
+	if (pairs > UINT32_MAX)
+		throw std::runtime_error("Too much text for one index segment");
+
+	std::vector<std::pair<uint32_t, uint32_t>> lists; // trigram, where its blocks start in flat
+	uint32_t start = 0;
+	for (uint32_t trigram = 0; trigram < cursor.size(); trigram++)
+	{
+		const uint32_t count = cursor[trigram];
+		if (count == 0)
+			continue;
+		lists.push_back({trigram, start});
+		cursor[trigram] = start; // now where the next block of this trigram goes
+		start += count;
+	}
+
+	std::vector<uint32_t> flat(pairs);
+	forEachPair([&](uint32_t trigram, uint32_t block) { flat[cursor[trigram]++] = block; });
+	cursor = {};
+	tokenized.clear();
+
+	std::vector<uint32_t> blocks;
+	for (size_t i = 0; i < lists.size(); i++)
+	{
+		const uint32_t end = i + 1 < lists.size() ? lists[i + 1].second : start;
+		blocks.assign(flat.begin() + lists[i].second, flat.begin() + end);
+		segment.m_addList(lists[i].first, blocks);
+	}
+	return segment;
+}
+
+// One mapped segment file
+class Segment
+{
+  public:
+	bool m_open(const std::string &path) // false if it's missing or unusable
+	{
+		try
+		{
+			p_sections = std::make_unique<BinaryCache::MappedSections>(path);
+			const auto header = p_sections->get<IndexHeader>(0);
+			if (header.size() != 1 || header[0].m_version != FORMAT_VERSION)
+				return false;
+			p_paths = p_sections->get<char>(1);
+			p_files = p_sections->get<IndexedFile>(2);
+			p_blocks = p_sections->get<IndexedBlock>(3);
+			p_lists = p_sections->get<PostingList>(4);
+			p_postings = p_sections->get<uint8_t>(5);
+		}
+		catch (const std::exception &)
+		{
+			p_sections.reset();
+			return false;
+		}
+		return true;
+	}
+
+	size_t m_fileCount() const { return p_files.size(); }
+	size_t m_blockCount() const { return p_blocks.size(); }
+	const IndexedFile &m_file(uint32_t id) const { return p_files[id]; }
+	const IndexedBlock &m_block(uint32_t id) const { return p_blocks[id]; }
+	std::span<const PostingList> m_lists() const { return p_lists; }
+	std::string_view m_path(uint32_t id) const { return {p_paths.data() + p_files[id].m_path_offset, p_files[id].m_path_length}; }
+
+	// Blocks that may have a match: every matching line contains one of "literals". Returns false when
+	// the literals can't narrow anything down (none, or one shorter than a trigram), every block is a candidate then
+	bool m_candidates(const std::vector<std::string> &literals, std::vector<uint32_t> &blocks) const
+	{
+		blocks.clear();
+		if (literals.empty())
+			return false;
+
+		std::vector<uint32_t> matching, list, both;
+		for (const std::string &literal : literals)
+		{
+			if (literal.size() < 3)
+				return false;
+
+			std::vector<const PostingList *> needed;
+			for (size_t i = 0; i + 3 <= literal.size(); i++)
+			{
+				const uint32_t trigram = pack(literal[i], literal[i + 1], literal[i + 2]);
+				auto it = std::lower_bound(p_lists.begin(), p_lists.end(), trigram,
+										   [](const PostingList &entry, uint32_t key) { return entry.m_trigram < key; });
+				if (it == p_lists.end() || it->m_trigram != trigram)
+				{
+					needed.clear(); // this literal is nowhere in the segment
+					break;
+				}
+				needed.push_back(&*it);
+			}
+			if (needed.empty())
+				continue;
+
+			// shortest list first, the intersection only gets smaller
+			std::sort(needed.begin(), needed.end(), [](const PostingList *lhs, const PostingList *rhs) { return lhs->m_count < rhs->m_count; });
+			needed.erase(std::unique(needed.begin(), needed.end()), needed.end());
+			m_decode(*needed[0], matching);
+			for (size_t i = 1; i < needed.size() && !matching.empty(); i++)
+			{
+				m_decode(*needed[i], list);
+				both.clear();
+				std::set_intersection(matching.begin(), matching.end(), list.begin(), list.end(), std::back_inserter(both));
+				matching.swap(both);
+			}
+			blocks.insert(blocks.end(), matching.begin(), matching.end());
+		}
+		std::sort(blocks.begin(), blocks.end());
+		blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+		return true;
+	}
+
+	// groups sorted block ids per file, neighbouring blocks become one range of up to MAX_RANGE_SIZE
+	std::vector<CandidateFile> m_group(const std::vector<uint32_t> &blocks) const
+	{
+		std::vector<CandidateFile> files;
+		for (size_t i = 0; i < blocks.size(); i++)
+		{
+			const IndexedBlock &block = p_blocks[blocks[i]];
+			if (files.empty() || files.back().m_file != &p_files[block.m_file])
+				files.push_back({&p_files[block.m_file], m_path(block.m_file), {}});
+			auto &ranges = files.back().m_ranges;
+			if (i > 0 && blocks[i - 1] + 1 == blocks[i] && !ranges.empty() && ranges.back().m_length + block.m_length <= MAX_RANGE_SIZE)
+				ranges.back().m_length += block.m_length;
+			else
+				ranges.push_back({block.m_offset, block.m_length, block.m_first_line});
+		}
+		return files;
+	}
+
+	void m_decode(const PostingList &list, std::vector<uint32_t> &out) const
+	{
+		out.resize(list.m_count);
+		const uint8_t *p = p_postings.data() + list.m_offset;
+		uint32_t block = 0;
+		for (uint32_t i = 0; i < list.m_count; i++)
+		{
+			block += getVarint(p);
+			out[i] = block;
+		}
+	}
+
+  private:
+	std::unique_ptr<BinaryCache::MappedSections> p_sections;
+	std::span<const char> p_paths;
+	std::span<const IndexedFile> p_files;
+	std::span<const IndexedBlock> p_blocks;
+	std::span<const PostingList> p_lists;
+	std::span<const uint8_t> p_postings;
+};
+
+/* Merges consecutive segments (oldest first) into one, straight from their tables:
+ * the newest entry of every path survives, its blocks get new ids and every posting list is
+ * the remapped union of the segments' lists. Tombstones are only kept while older segments remain under the merged one. */
+inline SegmentData mergeSegments(const std::vector<const Segment *> &segments, bool keep_tombstones)
+{
+	struct Entry
+	{
+		std::string_view m_path;
+		uint32_t m_segment;
+		uint32_t m_file;
+	};
+	std::vector<Entry> entries;
+	std::unordered_set<std::string_view> seen;
+	for (size_t s = segments.size(); s-- > 0;)
+	{
+		for (uint32_t f = 0; f < segments[s]->m_fileCount(); f++)
+		{
+			const std::string_view path = segments[s]->m_path(f);
+			if (!seen.insert(path).second)
+				continue; // a newer segment has this path
+			if ((segments[s]->m_file(f).m_flags & FILE_DELETED) == 0 || keep_tombstones)
+				entries.push_back({path, static_cast<uint32_t>(s), f});
+		}
+	}
+	seen = {};
+	std::sort(entries.begin(), entries.end(), [](const Entry &lhs, const Entry &rhs) { return lhs.m_path < rhs.m_path; });
+
+	// new block ids in path order, UINT32_MAX for the blocks of replaced files
+	SegmentData merged;
+	std::vector<std::vector<uint32_t>> remap(segments.size());
+	for (size_t s = 0; s < segments.size(); s++)
+		remap[s].assign(segments[s]->m_blockCount(), UINT32_MAX);
+	for (const Entry &entry : entries)
+	{
+		const Segment &segment = *segments[entry.m_segment];
+		const IndexedFile &file = segment.m_file(entry.m_file);
+		merged.m_addFile(entry.m_path, file.m_size, file.m_mtime, file.m_flags);
+		for (uint32_t b = file.m_first_block; b < file.m_first_block + file.m_block_count; b++)
+		{
+			remap[entry.m_segment][b] = static_cast<uint32_t>(merged.m_blocks.size());
+			merged.m_addBlock(segment.m_block(b));
+		}
+	}
+
+	// every segment's lists are sorted by trigram, walk them side by side
+	std::vector<size_t> next(segments.size(), 0);
+	std::vector<uint32_t> blocks, decoded;
+	for (;;)
+	{
+		uint32_t trigram = UINT32_MAX;
+		for (size_t s = 0; s < segments.size(); s++)
+		{
+			if (next[s] < segments[s]->m_lists().size())
+				trigram = std::min(trigram, segments[s]->m_lists()[next[s]].m_trigram);
+		}
+		if (trigram == UINT32_MAX)
+			break;
+
+		blocks.clear();
+		for (size_t s = 0; s < segments.size(); s++)
+		{
+			const auto lists = segments[s]->m_lists();
+			if (next[s] >= lists.size() || lists[next[s]].m_trigram != trigram)
+				continue;
+			segments[s]->m_decode(lists[next[s]++], decoded);
+			for (uint32_t block : decoded)
+			{
+				if (remap[s][block] != UINT32_MAX)
+					blocks.push_back(remap[s][block]);
+			}
+		}
+		if (blocks.empty())
+			continue;
+		std::sort(blocks.begin(), blocks.end());
+		merged.m_addList(trigram, blocks);
+	}
+	return merged;
+}
+
+/* A consistent view of the index: the manifest and every segment it lists, all mapped.
+ * A merge can replace the manifest and delete segments right after we read it, opening
+ * is simply retried then. Once open, nothing a writer does changes what this sees. */
+class TrigramIndex
+{
+  public:
+	bool m_open(const std::string &dir) // false when DIR has no (usable) index
+	{
+		for (int attempt = 0; attempt < 3; attempt++)
+		{
+			if (p_tryOpen(dir))
+				return true;
+		}
+		p_segments.clear();
+		return false;
+	}
+
+	const std::vector<SegmentInfo> &m_segmentInfo() const { return p_info; }
+	uint64_t m_nextSegment() const { return p_next_segment; }
+
+	// fn(std::string_view path, const IndexedFile &file) for every file currently in the index
+	template <typename Fn>
+	void m_forEachFile(Fn &&fn) const
+	{
+		for (size_t s = 0; s < p_segments.size(); s++)
+		{
+			const Segment &segment = *p_segments[s];
+			for (uint32_t f = 0; f < segment.m_fileCount(); f++)
+			{
+				if (p_isLive(s, segment.m_path(f), segment.m_file(f)))
+					fn(segment.m_path(f), segment.m_file(f));
+			}
+		}
+	}
+
+	/* Files that may have a match and their candidate ranges, see Segment::m_candidates.
+	 * With every_file the files without candidates are in the list too, with no ranges (for -c). */
+	bool m_candidates(const std::vector<std::string> &literals, std::vector<CandidateFile> &files, bool every_file = false) const
+	{
+		files.clear();
+		std::vector<uint32_t> blocks;
+		std::vector<bool> listed;
+		for (size_t s = 0; s < p_segments.size(); s++)
+		{
+			const Segment &segment = *p_segments[s];
+			if (!segment.m_candidates(literals, blocks))
+			{
+				files.clear();
+				return false;
+			}
+			listed.assign(every_file ? segment.m_fileCount() : 0, false);
+			for (CandidateFile &file : segment.m_group(blocks))
+			{
+				if (!p_isLive(s, file.m_path, *file.m_file))
+					continue;
+				if (every_file)
+					listed[static_cast<size_t>(file.m_file - &segment.m_file(0))] = true;
+				files.push_back(std::move(file));
+			}
+			for (uint32_t f = 0; f < listed.size(); f++)
+			{
+				if (!listed[f] && p_isLive(s, segment.m_path(f), segment.m_file(f)))
+					files.push_back({&segment.m_file(f), segment.m_path(f), {}});
+			}
+		}
+		return true;
+	}
+
+  private:
+	std::unique_ptr<BinaryCache::MappedSections> p_manifest;
+	std::vector<SegmentInfo> p_info;
+	std::vector<std::unique_ptr<Segment>> p_segments;
+	std::unordered_map<std::string_view, size_t> p_newest; // path -> newest segment that has it, over all segments but the oldest
+	uint64_t p_next_segment = 0;
+
+	bool p_tryOpen(const std::string &dir)
+	{
+		p_segments.clear();
+		p_newest.clear();
+		try
+		{
+			p_manifest = std::make_unique<BinaryCache::MappedSections>(indexPath(dir));
+			const auto header = p_manifest->get<ManifestHeader>(0);
+			if (header.size() != 1 || header[0].m_version != FORMAT_VERSION)
+				return false;
+			p_next_segment = header[0].m_next_segment;
+			const auto info = p_manifest->get<SegmentInfo>(1);
+			p_info.assign(info.begin(), info.end());
+		}
+		catch (const std::exception &)
+		{
+			return false;
+		}
+
+		for (const SegmentInfo &info : p_info)
+		{
+			p_segments.push_back(std::make_unique<Segment>());
+			if (!p_segments.back()->m_open(segmentPath(dir, info.m_id)))
+				return false; // merged away meanwhile
+		}
+		// the small newer segments are what hides entries, the big oldest one never has to be hashed
+		for (size_t s = 1; s < p_segments.size(); s++)
+		{
+			for (uint32_t f = 0; f < p_segments[s]->m_fileCount(); f++)
+				p_newest[p_segments[s]->m_path(f)] = s;
+		}
+		return true;
+	}
+
+	bool p_isLive(size_t segment, std::string_view path, const IndexedFile &file) const
+	{
+		if (file.m_flags & FILE_DELETED)
+			return false;
+		const auto it = p_newest.find(path);
+		return it == p_newest.end() ? segment == 0 : it->second == segment;
+	}
+};
+
+/* Keeps DIR's index up to date. Holds an flock on DIR/.txtfind-index.lock for its whole life,
+ * so there's one writer at a time, queries don't lock anything. */
+class IndexWriter
+{
+  public:
+	explicit IndexWriter(std::string dir) : p_dir(std::move(dir)) // throws std::runtime_error
+	{
+		const std::string lock = indexPath(p_dir) + ".lock";
+		p_lock_fd = ::open(lock.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+		if (p_lock_fd < 0 || ::flock(p_lock_fd, LOCK_EX) != 0)
+		{
+			if (p_lock_fd >= 0)
+				::close(p_lock_fd);
+			throw std::runtime_error("Failed to lock the index: " + lock);
+		}
+	}
+
+	~IndexWriter()
+	{
+		if (p_merge.joinable())
+			p_merge.join();
+		::close(p_lock_fd); // also drops the flock
+	}
+
+	IndexWriter(const IndexWriter &) = delete;
+	IndexWriter &operator=(const IndexWriter &) = delete;
+
+	/* Finds added, changed (size or mtime) and deleted files, tokenizes only the added and changed ones
+	 * and publishes them as a new segment. Without a usable index everything is indexed into one segment. */
+	BuildStats m_update(unsigned threads)
+	{
+		BuildStats stats;
+		std::vector<FileEntry> entries = walker::listFiles(p_dir, threads);
+		entries.erase(std::remove_if(entries.begin(), entries.end(), [](const FileEntry &entry) { return isIndexFile(entry.m_path); }), entries.end());
+		const size_t prefix = walker::joinPath(p_dir, "").size();
+
+		TrigramIndex index;
+		if (!index.m_open(p_dir))
+		{
+			stats.m_full = true;
+			p_segments.clear();
+			p_next_segment = 1;
+			std::vector<FileTrigrams> tokenized = tokenizeFiles(entries, prefix, threads);
+			for (const FileTrigrams &file : tokenized)
+				stats.m_bytes += file.m_ok ? file.m_size : 0;
+			p_write(tokenized, stats);
+			p_removeUnused();
+			return stats;
+		}
+		p_segments = index.m_segmentInfo();
+		p_next_segment = index.m_nextSegment();
+
+		// what the index has now, paths point into its mapping
+		std::unordered_map<std::string_view, const IndexedFile *> indexed;
+		index.m_forEachFile([&](std::string_view path, const IndexedFile &file) { indexed.emplace(path, &file); });
+		const uint64_t before = indexed.size();
+
+		std::vector<FileEntry> dirty;
+		for (FileEntry &entry : entries)
+		{
+			const auto it = indexed.find(std::string_view(entry.m_path).substr(prefix));
+			if (it == indexed.end())
+			{
+				stats.m_added++;
+				dirty.push_back(std::move(entry));
+				continue;
+			}
+			const IndexedFile &file = *it->second;
+			indexed.erase(it);
+			if (File::m_getfilesize(entry.m_path) != file.m_size || File::m_lastmodification_t(entry.m_path) != file.m_mtime)
+			{
+				stats.m_changed++;
+				dirty.push_back(std::move(entry));
+			}
+		}
+		stats.m_deleted = indexed.size(); // whatever wasn't found on disk anymore
+
+		std::vector<FileTrigrams> tokenized = tokenizeFiles(dirty, prefix, threads);
+		for (FileTrigrams &file : tokenized)
+		{
+			stats.m_bytes += file.m_ok ? file.m_size : 0;
+			file.m_deleted = !file.m_ok; // unreadable now, so it can't keep its old entry either
+		}
+		for (const auto &[path, file] : indexed)
+		{
+			FileTrigrams tombstone;
+			tombstone.m_path = path;
+			tombstone.m_deleted = true;
+			tokenized.push_back(std::move(tombstone));
+		}
+
+		if (!tokenized.empty())
+			p_write(tokenized, stats);
+		stats.m_files = before + stats.m_added - stats.m_deleted;
+		stats.m_segments = p_segments.size();
+		stats.m_index_bytes = p_indexBytes();
+		return stats;
+	}
+
+	// Starts merging the newest segments on a background thread when they've piled up, false if there's nothing to merge
+	bool m_startMerge()
+	{
+		const size_t first = p_pickMerge();
+		if (first + 1 >= p_segments.size())
+			return false;
+
+		p_merge = std::thread([this, first] {
+			try
+			{
+				p_mergeFrom(first);
+			}
+			catch (...)
+			{
+				p_merge_error = std::current_exception();
+			}
+		});
+		return true;
+	}
+
+	MergeStats m_finishMerge() // waits for the merge, rethrows what it threw
+	{
+		if (p_merge.joinable())
+			p_merge.join();
+		if (p_merge_error)
+			std::rethrow_exception(std::exchange(p_merge_error, nullptr));
+		return p_merge_stats;
+	}
+
+  private:
+	std::string p_dir;
+	int p_lock_fd = -1;
+	std::vector<SegmentInfo> p_segments; // what the published manifest lists
+	uint64_t p_next_segment = 1;
+	std::thread p_merge;
+	std::exception_ptr p_merge_error;
+	MergeStats p_merge_stats;
+
+	// writes the segment and publishes a manifest with it on top
+	void p_write(std::vector<FileTrigrams> &tokenized, BuildStats &stats)
+	{
+		const SegmentData segment = invertFiles(tokenized);
+		const uint64_t id = p_next_segment++;
+		segment.m_save(segmentPath(p_dir, id));
+		p_segments.push_back({id, segment.m_files.size(), p_fileSize(segmentPath(p_dir, id))});
+		p_publish();
+
+		stats.m_blocks = segment.m_blocks.size();
+		stats.m_trigrams = segment.m_lists.size();
+		stats.m_segments = p_segments.size();
+		stats.m_index_bytes = p_indexBytes();
+		if (stats.m_full)
+			stats.m_files = segment.m_files.size();
+	}
+
+	void p_publish() const // the rename is what makes it visible, all at once
+	{
+		const std::vector<ManifestHeader> header = {{FORMAT_VERSION, 0, p_next_segment}};
+		BinaryCache::SectionWriter writer;
+		writer.add(header);
+		writer.add(p_segments);
+		writer.save(indexPath(p_dir));
+	}
+
+	/* Size tiered: the newest segment always joins, an older one joins while it isn't more than MERGE_RATIO
+	 * times the size of what's collected so far. Each byte gets rewritten about log(total/update) times. */
+	size_t p_pickMerge() const
+	{
+		size_t first = p_segments.size();
+		uint64_t collected = 0;
+		while (first > 0 && (first == p_segments.size() || p_segments[first - 1].m_bytes <= MERGE_RATIO * collected))
+			collected += p_segments[--first].m_bytes;
+		if (p_segments.size() > MAX_SEGMENTS)
+			first = std::min(first, MAX_SEGMENTS - 1);
+		return first;
+	}
+
+	void p_mergeFrom(size_t first)
+	{
+		std::vector<std::unique_ptr<Segment>> opened;
+		std::vector<const Segment *> segments;
+		for (size_t s = first; s < p_segments.size(); s++)
+		{
+			opened.push_back(std::make_unique<Segment>());
+			if (!opened.back()->m_open(segmentPath(p_dir, p_segments[s].m_id)))
+				throw std::runtime_error("Failed to open index segment: " + segmentPath(p_dir, p_segments[s].m_id));
+			segments.push_back(opened.back().get());
+		}
+
+		const SegmentData merged = mergeSegments(segments, first > 0);
+		const uint64_t id = p_next_segment++;
+		merged.m_save(segmentPath(p_dir, id));
+		opened.clear();
+
+		p_merge_stats = {p_segments.size() - first, p_fileSize(segmentPath(p_dir, id))};
+		p_segments.resize(first);
+		p_segments.push_back({id, merged.m_files.size(), p_merge_stats.m_bytes});
+		p_publish();
+		p_removeUnused(); // queries that still have the old segments mapped keep reading them
+	}
+
+	// deletes segment files the manifest doesn't list anymore and temporaries left by a crash
+	void p_removeUnused() const
+	{
+		DIR *handle = ::opendir(p_dir.c_str());
+		if (handle == nullptr)
+			return;
+		const std::string prefix = std::string(INDEX_NAME) + ".";
+		while (const dirent *entry = ::readdir(handle))
+		{
+			const std::string_view name = entry->d_name;
+			if (name.compare(0, prefix.size(), prefix) != 0)
+				continue;
+			const std::string_view rest = name.substr(prefix.size());
+			bool unused = rest.size() > 4 && rest.compare(rest.size() - 4, 4, ".tmp") == 0;
+			if (!rest.empty() && std::all_of(rest.begin(), rest.end(), [](char c) { return c >= '0' && c <= '9'; }))
+			{
+				const uint64_t id = std::stoull(std::string(rest));
+				unused = std::none_of(p_segments.begin(), p_segments.end(), [id](const SegmentInfo &info) { return info.m_id == id; });
+			}
+			if (unused)
+				::unlinkat(::dirfd(handle), entry->d_name, 0);
+		}
+		::closedir(handle);
+	}
+
+	uint64_t p_indexBytes() const
+	{
+		uint64_t total = 0;
+		for (const SegmentInfo &info : p_segments)
+			total += info.m_bytes;
+		return total;
+	}
+
+	static uint64_t p_fileSize(const std::string &path)
+	{
+		struct stat st;
+		return ::stat(path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+	}
+};
+
+// pread()s one range into a buffer of the calling thread, "block" stays valid until the thread's next call
+inline bool readRange(InputFile &input, const CandidateRange &range, std::string_view &block)
+{
+	static thread_local std::vector<char> buffer;
+	if (range.m_offset + range.m_length > input.m_size())
+		return false; // the file shrank since it was indexed
+	if (buffer.size() > MAX_RANGE_SIZE && range.m_length <= MAX_RANGE_SIZE)
+		std::vector<char>().swap(buffer); // a block with a huge line grew it, don't keep that around
+	if (buffer.size() < range.m_length)
+		buffer.resize(range.m_length);
+
+	size_t done = 0;
+	while (done < range.m_length)
+	{
+		const ssize_t n = ::pread(input.m_fd(), buffer.data() + done, range.m_length - done, static_cast<off_t>(range.m_offset + done));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		done += static_cast<size_t>(n);
+	}
+	block = std::string_view(buffer.data(), range.m_length);
+	return true;
+}
+
+// fn(std::string_view block, uint64_t offset, uint64_t first_line) -> bool, the ranges are pread() one by one
+template <typename Fn>
+bool forEachRange(InputFile &input, const std::vector<CandidateRange> &ranges, Fn &&fn)
+{
+	for (const CandidateRange &range : ranges)
+	{
+		std::string_view block;
+		if (!readRange(input, range, block))
+			return false;
+		if (!fn(block, range.m_offset, range.m_first_line))
+			return true;
+	}
+	return true;
+}
+} // namespace trigram
+
+#endif // index.hpp
@@ -0,0 +1,206 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef MATCHER_HPP
+#define MATCHER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstring>
+
+#include "../libutils/src/funcs.hpp"
+#include "../libutils/src/ahocorasick.hpp"
+#include "../libutils/src/teddy.hpp"
+#include "../libutils/src/regex.hpp"
+
+// A matcher looks for hits inside a block of whole lines, the scanner takes care of the line boundaries
+class Matcher
+{
+  public:
+	virtual ~Matcher() = default;
+
+	virtual const char *m_find(const char *begin, const char *end) const = 0; // returns a pointer inside the first matching line of [begin, end), nullptr if nothing matches
+	virtual void m_describe(std::string_view line, std::string &out) const = 0;	// appends what was found in a matching line, for the "'...' found on line" message
+	virtual std::unique_ptr<Matcher> m_clone() const { return nullptr; }		// a copy for another thread, nullptr when the matcher has no state and can be shared
+	virtual std::vector<std::string> m_requiredLiterals() const = 0;			// every matching line contains one of these, empty if there's no such set (for the index)
+};
+
+class LiteralMatcher : public Matcher
+{
+  public:
+	explicit LiteralMatcher(std::string needle, bool case_insensitive = false)
+		: p_needle(std::move(needle)), p_folded(simd::foldAscii(p_needle)), p_nocase(case_insensitive) {}
+
+	const char *m_find(const char *begin, const char *end) const override
+	{
+		if (p_nocase)
+			return simd::findNoCase(begin, end, p_folded.data(), p_folded.size());
+		return funcs::findSequence(begin, end, p_needle);
+	}
+
+	void m_describe(std::string_view, std::string &out) const override
+	{
+		out += p_needle;
+	}
+
+	std::vector<std::string> m_requiredLiterals() const override { return {p_needle}; }
+
+  private:
+	std::string p_needle;
+	std::string p_folded; // folded once here, the haystack is folded in registers by the kernel
+	bool p_nocase;
+};
+
+// -f with a big pattern list, one pass over the file no matter how many patterns there are
+class AhoCorasickMatcher : public Matcher
+{
+  public:
+	explicit AhoCorasickMatcher(const std::vector<std::string> &patterns, bool case_insensitive = false)
+	{
+		p_automaton.m_build(patterns, case_insensitive);
+	}
+
+	const char *m_find(const char *begin, const char *end) const override
+	{
+		return p_automaton.m_find(begin, end);
+	}
+
+	void m_describe(std::string_view line, std::string &out) const override
+	{
+		std::vector<uint32_t> ids;
+		p_automaton.m_findAll(line, ids);
+		for (size_t i = 0; i < ids.size(); i++)
+		{
+			if (i != 0)
+				out += "', '";
+			out += p_automaton.m_pattern(ids[i]);
+		}
+	}
+
+	std::vector<std::string> m_requiredLiterals() const override
+	{
+		std::vector<std::string> patterns;
+		for (uint32_t id = 0; id < p_automaton.m_patternCount(); id++)
+			patterns.push_back(p_automaton.m_pattern(id));
+		return patterns;
+	}
+
+  private:
+	AhoCorasick p_automaton;
+};
+
+// a handful of patterns (ERROR|FATAL|panic...), checks 16/32 bytes against all of them per step
+class TeddyMatcher : public Matcher
+{
+  public:
+	explicit TeddyMatcher(Teddy teddy, bool case_insensitive) : p_teddy(std::move(teddy)), p_nocase(case_insensitive) {}
+
+	const char *m_find(const char *begin, const char *end) const override
+	{
+		return p_teddy.m_find(begin, end);
+	}
+
+	void m_describe(std::string_view line, std::string &out) const override
+	{
+		bool first = true;
+		for (size_t id = 0; id < p_teddy.m_patternCount(); id++)
+		{
+			const std::string &pattern = p_teddy.m_pattern(id); // already folded with -i
+			const char *at = p_nocase ? simd::findNoCase(line.data(), line.data() + line.size(), pattern.data(), pattern.size())
+									  : funcs::findSequence(line.data(), line.data() + line.size(), pattern);
+			if (at == nullptr)
+				continue;
+			if (!first)
+				out += "', '";
+			out += pattern;
+			first = false;
+		}
+	}
+
+	std::vector<std::string> m_requiredLiterals() const override
+	{
+		std::vector<std::string> patterns;
+		for (size_t id = 0; id < p_teddy.m_patternCount(); id++)
+			patterns.push_back(p_teddy.m_pattern(id));
+		return patterns;
+	}
+
+  private:
+	Teddy p_teddy;
+	bool p_nocase;
+};
+
+// -e REGEX, the regex only runs on lines that contain one of its required literals (when it has some)
+class RegexMatcher : public Matcher
+{
+  public:
+	explicit RegexMatcher(Regex regex, std::shared_ptr<const Matcher> prefilter)
+		: p_regex(std::move(regex)), p_prefilter(std::move(prefilter)) {}
+
+	const char *m_find(const char *begin, const char *end) const override
+	{
+		if (p_prefilter == nullptr)
+			return p_regex.m_findLine(begin, end);
+
+		const char *p = begin;
+		while (p < end)
+		{
+			const char *candidate = p_prefilter->m_find(p, end);
+			if (candidate == nullptr)
+				return nullptr;
+
+			const char *line = static_cast<const char *>(memrchr(p, '\n', static_cast<size_t>(candidate - p)));
+			line = line != nullptr ? line + 1 : p;
+			const char *line_end = static_cast<const char *>(std::memchr(candidate, '\n', static_cast<size_t>(end - candidate)));
+			if (line_end == nullptr)
+				line_end = end;
+
+			if (p_regex.m_matchLine(line, line_end))
+				return line;
+			p = line_end + 1;
+		}
+		return nullptr;
+	}
+
+	void m_describe(std::string_view, std::string &out) const override
+	{
+		out += p_regex.m_pattern();
+	}
+
+	std::unique_ptr<Matcher> m_clone() const override
+	{
+		return std::make_unique<RegexMatcher>(*this); // the DFA cache can't be shared, the prefilter can
+	}
+
+	std::vector<std::string> m_requiredLiterals() const override { return p_regex.m_requiredLiterals(); }
+
+  private:
+	mutable Regex p_regex; // the lazy DFA fills its cache while searching
+	std::shared_ptr<const Matcher> p_prefilter;
+};
+
+// picks the engine for a pattern set: one literal, a small set (Teddy) or a big one (Aho-Corasick)
+inline std::unique_ptr<Matcher> makeMatcher(const std::vector<std::string> &patterns, bool case_insensitive = false)
+{
+	if (patterns.size() == 1)
+		return std::make_unique<LiteralMatcher>(patterns[0], case_insensitive);
+
+	Teddy teddy;
+	if (patterns.size() <= Teddy::MAX_PATTERNS && teddy.m_build(patterns, case_insensitive))
+		return std::make_unique<TeddyMatcher>(std::move(teddy), case_insensitive);
+
+	return std::make_unique<AhoCorasickMatcher>(patterns, case_insensitive);
+}
+
+inline std::unique_ptr<Matcher> makeRegexMatcher(Regex regex, bool case_insensitive = false)
+{
+	std::shared_ptr<const Matcher> prefilter;
+	if (!regex.m_requiredLiterals().empty())
+		prefilter = makeMatcher(regex.m_requiredLiterals(), case_insensitive);
+	return std::make_unique<RegexMatcher>(std::move(regex), std::move(prefilter));
+}
+
+#endif // matcher.hpp
@@ -0,0 +1,119 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef OUTPUT_HPP
+#define OUTPUT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <charconv>
+#include <string>
+#include <string_view>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Text built up in memory, for output that has to be written in one piece (a whole file's hits)
+class OutputBuffer
+{
+  public:
+	void m_append(std::string_view text) { p_text.append(text); }
+	void m_appendNumber(uint64_t number)
+	{
+		char digits[24];
+		const auto result = std::to_chars(digits, digits + sizeof(digits), number);
+		p_text.append(digits, static_cast<size_t>(result.ptr - digits));
+	}
+
+	std::string_view m_view() const { return p_text; }
+	bool m_empty() const { return p_text.empty(); }
+	void m_clear() { p_text.clear(); } // keeps the memory for the next file
+
+  private:
+	std::string p_text;
+};
+
+/* Formats straight into one big reusable buffer and writes it to the fd when it's full,
+ * instead of one std::cout << per piece. Text too big to be worth copying (a huge line) goes out
+ * together with whatever is buffered in a single writev, without being copied.
+ * Not thread safe, one thread writes (or it's behind a mutex). */
+class OutputSink
+{
+  public:
+	static constexpr size_t BUFFER_SIZE = size_t(1) << 20;
+	static constexpr size_t DIRECT_THRESHOLD = size_t(64) << 10;
+
+	explicit OutputSink(int fd = STDOUT_FILENO) : p_fd(fd) { p_buffer.reserve(BUFFER_SIZE); }
+	~OutputSink() { m_flush(); }
+	OutputSink(const OutputSink &) = delete;
+	OutputSink &operator=(const OutputSink &) = delete;
+
+	void m_append(std::string_view text)
+	{
+		if (text.size() >= DIRECT_THRESHOLD)
+		{
+			p_writeWith(text);
+			return;
+		}
+		if (p_buffer.size() + text.size() > BUFFER_SIZE)
+			m_flush();
+		p_buffer.append(text);
+	}
+
+	void m_appendNumber(uint64_t number)
+	{
+		char digits[24];
+		const auto result = std::to_chars(digits, digits + sizeof(digits), number);
+		m_append(std::string_view(digits, static_cast<size_t>(result.ptr - digits)));
+	}
+
+	bool m_flush() { return p_writeWith({}); }
+	bool m_ok() const { return p_ok; } // false once a write failed (disk full, closed pipe...)
+
+  private:
+	int p_fd;
+	std::string p_buffer;
+	bool p_ok = true;
+
+	bool p_writeWith(std::string_view extra) // buffered text + extra in one writev
+	{
+		iovec parts[2];
+		int count = 0;
+		if (!p_buffer.empty())
+			parts[count++] = {p_buffer.data(), p_buffer.size()};
+		if (!extra.empty())
+			parts[count++] = {const_cast<char *>(extra.data()), extra.size()};
+
+		iovec *part = parts;
+		while (p_ok && count > 0)
+		{
+			const ssize_t written = writev(p_fd, part, count);
+			if (written < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				p_ok = false;
+				break;
+			}
+			// partial write, skip what's already out
+			size_t left = static_cast<size_t>(written);
+			while (count > 0 && left >= part->iov_len)
+			{
+				left -= part->iov_len;
+				part++;
+				count--;
+			}
+			if (count > 0)
+			{
+				part->iov_base = static_cast<char *>(part->iov_base) + left;
+				part->iov_len -= left;
+			}
+		}
+		p_buffer.clear();
+		return p_ok;
+	}
+};
+
+#endif // output.hpp
@@ -0,0 +1,271 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "matcher.hpp"
+#include "scanner.hpp"
+
+/* Searching one big file on several threads:
+ * the file is cut into newline-aligned chunks, workers grab chunks in order and search them
+ * with their own LineSearcher starting at line 0, so each chunk ends up with its hits (line numbers
+ * relative to the chunk) and its total newline count. The calling thread then emits the chunks in
+ * order and turns the relative line numbers into real ones with a running prefix sum of the newline
+ * counts, so the output is byte for byte the same as a serial run.
+ * searchChunks() and countChunks() are that machinery for any list of chunks (the block filter's ranges). */
+
+namespace parallel
+{
+constexpr size_t MIN_CHUNK_SIZE = size_t(1) << 20;	// 1MB
+constexpr size_t MAX_CHUNK_SIZE = size_t(64) << 20; // 64MB
+constexpr size_t CHUNKS_PER_THREAD = 8;				// keeps the threads busy when chunks take different times
+constexpr size_t INFLIGHT_PER_THREAD = 4;			// how far workers may run ahead of the output, bounds memory
+
+struct ChunkHit
+{
+	uint64_t m_line;	   // relative to the start of the chunk (0 = first line of the chunk)
+	uint64_t m_offset;	   // byte offset of the line in the file
+	size_t m_text_begin;   // where the line sits in ChunkResult::m_text
+	size_t m_text_length;
+};
+
+struct ChunkResult
+{
+	uint64_t m_newlines = 0;
+	std::vector<ChunkHit> m_hits;
+	std::string m_text; // copies of the hit lines, the mapping is gone by the time they're printed
+	bool m_ok = true;
+};
+
+inline unsigned resolveThreads(unsigned requested) // 0 means one per core
+{
+	if (requested != 0)
+		return requested;
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+inline size_t chunkSizeFor(uint64_t file_size, unsigned threads)
+{
+	uint64_t size = file_size / (static_cast<uint64_t>(threads) * CHUNKS_PER_THREAD);
+	size = std::clamp<uint64_t>(size, MIN_CHUNK_SIZE, MAX_CHUNK_SIZE);
+	return static_cast<size_t>(size & ~(MappedWindow::m_pageSize() - 1));
+}
+
+// returns the start of the first line that begins at or after "nominal"
+inline uint64_t alignToLine(int fd, uint64_t nominal, uint64_t file_size)
+{
+	if (nominal == 0)
+		return 0;
+
+	char buffer[1 << 16];
+	uint64_t pos = nominal - 1; // if the byte before nominal is a '\n', nominal already starts a line
+	while (pos < file_size)
+	{
+		ssize_t n = ::pread(fd, buffer, sizeof(buffer), static_cast<off_t>(pos));
+		if (n <= 0)
+			break;
+		const char *newline = static_cast<const char *>(std::memchr(buffer, '\n', static_cast<size_t>(n)));
+		if (newline != nullptr)
+			return pos + static_cast<uint64_t>(newline - buffer) + 1;
+		pos += static_cast<uint64_t>(n);
+	}
+	return file_size;
+}
+
+// chunk i is [bounds[i], bounds[i + 1]), every chunk starts at the beginning of a line
+inline std::vector<uint64_t> splitOnLines(int fd, uint64_t file_size, size_t chunk_size)
+{
+	std::vector<uint64_t> bounds;
+	for (uint64_t nominal = 0; nominal < file_size; nominal += chunk_size)
+	{
+		uint64_t start = alignToLine(fd, nominal, file_size);
+		if (bounds.empty() || start > bounds.back()) // a line longer than a chunk swallows the next boundary
+			bounds.push_back(start);
+	}
+	if (bounds.empty() || bounds.back() != file_size)
+		bounds.push_back(file_size);
+	return bounds;
+}
+
+/* search(size_t index, const Matcher &, ChunkResult &, auto &collect) -> bool searches chunk "index" on a
+ * worker, handing its hits to collect(const ScanHit &) and setting the result's m_newlines, false on a read
+ * error. A hit's line is relative to "base_line" plus the newlines of the chunks before it.
+ * report(const ScanHit &) -> bool is only ever called from the calling thread, in chunk order */
+template <typename Search, typename Report>
+bool searchChunks(size_t chunk_count, const Matcher &matcher, unsigned threads, uint64_t base_line, Search &&search, Report &&report)
+{
+	const size_t max_inflight = static_cast<size_t>(threads) * INFLIGHT_PER_THREAD;
+
+	std::vector<ChunkResult> results(chunk_count);
+	std::vector<char> done(chunk_count, 0);
+	size_t next_chunk = 0; // next chunk a worker will take
+	size_t emitted = 0;	   // chunks already handed to report()
+	std::atomic<bool> cancelled{false};
+	std::mutex mutex;
+	std::condition_variable cv;
+
+	auto worker = [&]() {
+		const std::unique_ptr<Matcher> local = matcher.m_clone(); // per thread state (regex DFA cache)
+		const Matcher &thread_matcher = local != nullptr ? *local : matcher;
+		while (true)
+		{
+			size_t index;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [&] { return cancelled.load() || next_chunk < emitted + max_inflight; });
+				if (cancelled.load() || next_chunk >= chunk_count)
+					return;
+				index = next_chunk++;
+			}
+
+			ChunkResult &result = results[index];
+			auto collect = [&](const ScanHit &hit) -> bool {
+				result.m_hits.push_back({hit.m_line_number, hit.m_offset, result.m_text.size(), hit.m_line.size()});
+				result.m_text.append(hit.m_line);
+				return !cancelled.load(std::memory_order_relaxed);
+			};
+			result.m_ok = search(index, thread_matcher, result, collect);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				done[index] = 1;
+			}
+			cv.notify_all();
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (unsigned i = 0; i < std::min<size_t>(threads, chunk_count); i++)
+		pool.emplace_back(worker);
+
+	bool ok = true;
+	for (size_t index = 0; index < chunk_count && !cancelled.load(); index++)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [&] { return done[index] != 0; });
+		}
+
+		ChunkResult &result = results[index];
+		ok = ok && result.m_ok;
+		{
+			profiler::Scope<stats::Zone::output> output_zone; // a chunk's hits at once, not every hit on its own
+			if (!result.m_hits.empty())
+				output_zone.m_countAs(result.m_hits.size());
+			for (const ChunkHit &hit : result.m_hits)
+			{
+				std::string_view line(result.m_text.data() + hit.m_text_begin, hit.m_text_length);
+				if (!report(ScanHit{base_line + hit.m_line, hit.m_offset, line}))
+				{
+					std::lock_guard<std::mutex> lock(mutex); // so no worker misses the wakeup below
+					cancelled.store(true);
+					break;
+				}
+			}
+		}
+		base_line += result.m_newlines;
+		result = ChunkResult{}; // give the memory back right away
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			emitted = index + 1;
+		}
+		cv.notify_all();
+	}
+
+	cv.notify_all(); // workers waiting for room have to see the cancellation
+	for (auto &thread : pool)
+		thread.join();
+	return ok;
+}
+
+// report(const ScanHit &) -> bool is only ever called from the calling thread, in file order
+template <typename Report>
+bool searchFile(InputFile &input, const Matcher &matcher, unsigned threads, Report &&report)
+{
+	const uint64_t file_size = input.m_size();
+	const std::vector<uint64_t> bounds = splitOnLines(input.m_fd(), file_size, chunkSizeFor(file_size, threads));
+	auto search = [&](size_t index, const Matcher &chunk_matcher, ChunkResult &result, auto &collect) -> bool {
+		LineSearcher searcher(chunk_matcher, 0);
+		const bool read = scanner::forEachMappedBlock(input.m_fd(), bounds[index], bounds[index + 1],
+													  [&](std::string_view block, uint64_t offset) -> bool {
+														  return searcher.m_searchBlock(block, offset, collect);
+													  });
+		result.m_newlines = searcher.m_lineNumber();
+		return read;
+	};
+	return searchChunks(bounds.size() - 1, matcher, threads, 1, search, report);
+}
+
+/* -c/-l/-q: the order doesn't matter here, so chunks are just counted and summed. read(size_t index, auto &&fn) -> bool
+ * calls fn(std::string_view block) -> bool for the blocks of chunk "index" until it returns false, and returns
+ * false on a read error. Every worker stops as soon as the total reaches "limit" (1 for -l/-q). */
+template <typename Read>
+bool countChunks(size_t chunk_count, const Matcher &matcher, unsigned threads, uint64_t limit, uint64_t &count, Read &&read)
+{
+	count = 0;
+	if (limit == 0)
+		return true;
+
+	std::atomic<size_t> next_chunk{0};
+	std::atomic<uint64_t> total{0};
+	std::atomic<bool> done{false};
+	std::atomic<bool> ok{true};
+	auto stop = [&]() -> bool { return done.load(std::memory_order_relaxed); };
+
+	auto worker = [&]() {
+		const std::unique_ptr<Matcher> local = matcher.m_clone();
+		const Matcher &thread_matcher = local != nullptr ? *local : matcher;
+		while (!stop())
+		{
+			const size_t index = next_chunk.fetch_add(1);
+			if (index >= chunk_count)
+				return;
+			const bool chunk_ok = read(index, [&](std::string_view block) -> bool {
+				const uint64_t found = scanner::countBlock(thread_matcher, block, limit, stop);
+				if (total.fetch_add(found) + found >= limit)
+					done.store(true);
+				return !stop();
+			});
+			if (!chunk_ok)
+				ok.store(false);
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (unsigned i = 1; i < std::min<size_t>(threads, chunk_count); i++)
+		pool.emplace_back(worker);
+	worker(); // the calling thread has nothing else to do
+	for (auto &thread : pool)
+		thread.join();
+
+	count = std::min(total.load(), limit);
+	return ok.load();
+}
+
+// -c/-l/-q on one big file
+inline bool countMatches(InputFile &input, const Matcher &matcher, unsigned threads, uint64_t limit, uint64_t &count)
+{
+	const uint64_t file_size = input.m_size();
+	const std::vector<uint64_t> bounds = splitOnLines(input.m_fd(), file_size, chunkSizeFor(file_size, threads));
+	return countChunks(bounds.size() - 1, matcher, threads, limit, count, [&](size_t index, auto &&fn) -> bool {
+		return scanner::forEachMappedBlock(input.m_fd(), bounds[index], bounds[index + 1],
+										   [&](std::string_view block, uint64_t) -> bool { return fn(block); });
+	});
+}
+} // namespace parallel
+
+#endif // parallel.hpp
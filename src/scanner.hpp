@@ -0,0 +1,439 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef SCANNER_HPP
+#define SCANNER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "matcher.hpp"
+#include "decompress.hpp"
+#include "stats.hpp"
+#include "../libutils/src/simd.hpp"
+
+/* How a file gets scanned:
+ * regular files are mmap'd one window at a time (so RSS stays bounded on files bigger than RAM),
+ * pipes and special files go through a plain read() buffer,
+ * .gz/.zst files (told apart by their magic bytes, not the name) get decompressed on the way (decompress.hpp)
+ * and small files the io_uring loader already read (uring.hpp) are scanned right in its buffer.
+ * Both hand out blocks made of whole lines, the matcher runs over the entire block
+ * and line boundaries/numbers are only worked out around the hits. */
+
+namespace scanner
+{
+constexpr size_t WINDOW_SIZE = size_t(64) << 20;	  // 64MB mapped at a time
+constexpr size_t READ_BUFFER_SIZE = size_t(1) << 20; // 1MB for the read() fallback
+constexpr uint64_t MMAP_THRESHOLD = 256 << 10;		  // smaller files are cheaper to read() than to map
+constexpr size_t HEAD_SIZE = size_t(64) << 10;		  // read when a file is opened: magic bytes, binary sniffing, and all of a small file
+} // namespace scanner
+
+struct ScanHit
+{
+	uint64_t m_line_number;	 // starts at 1
+	uint64_t m_offset;		 // byte offset of the line in the file
+	std::string_view m_line; // without the '\n'
+};
+
+class InputFile
+{
+  public:
+	InputFile() = default;
+	~InputFile() { m_close(); }
+
+	InputFile(const InputFile &) = delete;
+	InputFile &operator=(const InputFile &) = delete;
+
+	bool m_open(const std::string &path)
+	{
+		m_close();
+		p_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (p_fd < 0)
+			return false;
+		if (::fstat(p_fd, &p_stat) != 0)
+		{
+			m_close();
+			return false;
+		}
+		p_readHead();
+		return true;
+	}
+
+	/* A file somebody else opened and owns (the io_uring loader), "contents" is all of it when it's
+	 * already in memory, nullptr to read it from fd as usual */
+	void m_adopt(int fd, const struct stat &st, const char *contents)
+	{
+		m_close();
+		p_fd = fd;
+		p_owned = false;
+		p_stat = st;
+		p_contents = contents;
+		p_readHead();
+	}
+
+	void m_close()
+	{
+		if (p_fd >= 0 && p_owned)
+			::close(p_fd);
+		p_fd = -1;
+		p_owned = true;
+		p_contents = nullptr;
+		p_head = {};
+	}
+
+	int m_fd() const { return p_fd; }
+	uint64_t m_size() const { return static_cast<uint64_t>(p_stat.st_size); }
+	int64_t m_mtime() const { return static_cast<int64_t>(p_stat.st_mtime); } // seconds
+	decompress::Compression m_compression() const { return p_compression; }
+	const char *m_contents() const { return p_contents; } // the whole file when it's small enough to be in memory already
+	std::string_view m_head() const { return p_head; }	  // the first HEAD_SIZE bytes (less for small files, empty for pipes)
+	// pipes, ttys, /proc files... can't be mmap'd reliably, and compressed files have to be read as a stream
+	bool m_isMappable() const { return S_ISREG(p_stat.st_mode) && p_stat.st_size > 0 && p_compression == decompress::Compression::none; }
+
+  private:
+	int p_fd = -1;
+	struct stat p_stat = {};
+	decompress::Compression p_compression = decompress::Compression::none;
+	bool p_owned = true;
+	const char *p_contents = nullptr;
+	std::string_view p_head;
+	std::unique_ptr<char[]> p_head_buffer;
+
+	// one pread of the start of a regular file, a file that fits is never read again
+	void p_readHead()
+	{
+		if (p_contents != nullptr)
+			p_head = std::string_view(p_contents, static_cast<size_t>(std::min<uint64_t>(m_size(), scanner::HEAD_SIZE)));
+		else if (S_ISREG(p_stat.st_mode) && p_stat.st_size > 0)
+		{
+			if (p_head_buffer == nullptr)
+				p_head_buffer = std::make_unique_for_overwrite<char[]>(scanner::HEAD_SIZE);
+			ssize_t n;
+			do
+				n = ::pread(p_fd, p_head_buffer.get(), scanner::HEAD_SIZE, 0);
+			while (n < 0 && errno == EINTR);
+			p_head = std::string_view(p_head_buffer.get(), n > 0 ? static_cast<size_t>(n) : 0);
+			if (p_head.size() == m_size())
+				p_contents = p_head.data();
+		}
+
+		p_compression = decompress::Compression::none;
+		if (p_head.size() >= 4)
+			p_compression = decompress::detect(reinterpret_cast<const unsigned char *>(p_head.data()), p_head.size());
+	}
+};
+
+// A single mmap'd window over a file, mapping a new window releases the old one
+class MappedWindow
+{
+  public:
+	MappedWindow() = default;
+	~MappedWindow() { m_unmap(); }
+
+	MappedWindow(const MappedWindow &) = delete;
+	MappedWindow &operator=(const MappedWindow &) = delete;
+
+	// maps [offset, offset + length), offset has to be page aligned. Returns an empty view on failure
+	std::string_view m_map(int fd, uint64_t offset, size_t length)
+	{
+		m_unmap();
+		void *addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+		if (addr == MAP_FAILED)
+			return {};
+		::madvise(addr, length, MADV_SEQUENTIAL);
+		p_addr = addr;
+		p_length = length;
+		return {static_cast<const char *>(addr), length};
+	}
+
+	void m_unmap()
+	{
+		if (p_addr != nullptr)
+			::munmap(p_addr, p_length);
+		p_addr = nullptr;
+		p_length = 0;
+	}
+
+	static uint64_t m_pageSize()
+	{
+		static const uint64_t page_size = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+		return page_size;
+	}
+
+  private:
+	void *p_addr = nullptr;
+	size_t p_length = 0;
+};
+
+// Keeps the line count between blocks, so one instance has to see the blocks of a file in order
+class LineSearcher
+{
+  public:
+	explicit LineSearcher(const Matcher &matcher, uint64_t first_line = 1)
+		: p_matcher(matcher), p_line_number(first_line) {}
+
+	// hits are found HIT_BATCH at a time, then their lines worked out and reported, so --stats times batches and not single hits
+	static constexpr size_t HIT_BATCH = 64;
+
+	// report(const ScanHit &) -> bool, returning false stops the search
+	template <typename Report>
+	bool m_searchBlock(std::string_view block, uint64_t block_offset, Report &&report)
+	{
+		profiler::Scope<stats::Zone::match> zone;
+		zone.m_addBytes(block.size());
+		const char *p = block.data(); // always sits at the start of a line
+		const char *end = p + block.size();
+		const char *counted = p; // newlines before this are already in p_line_number
+
+		struct Found
+		{
+			const char *m_from; // where the search that found it started, a line start
+			const char *m_hit;
+			const char *m_line_end;
+		};
+		Found found[HIT_BATCH];
+		ScanHit hits[HIT_BATCH];
+		bool more = true;
+		while (more && p < end)
+		{
+			size_t count = 0;
+			while (count < HIT_BATCH && p < end)
+			{
+				const char *hit = p_matcher.m_find(p, end);
+				if (hit == nullptr)
+				{
+					more = false;
+					break;
+				}
+				const char *line_end = static_cast<const char *>(::memchr(hit, '\n', static_cast<size_t>(end - hit)));
+				if (line_end == nullptr)
+					line_end = end;
+				found[count++] = {p, hit, line_end};
+				p = (line_end < end) ? line_end + 1 : end;
+			}
+			if (count == 0)
+				break;
+
+			{
+				profiler::Scope<stats::Zone::line> line_zone;
+				line_zone.m_countAs(count);
+				for (size_t i = 0; i < count; i++)
+				{
+					const char *line_begin = static_cast<const char *>(::memrchr(found[i].m_from, '\n', static_cast<size_t>(found[i].m_hit - found[i].m_from)));
+					line_begin = (line_begin == nullptr) ? found[i].m_from : line_begin + 1;
+					p_line_number += static_cast<uint64_t>(simd::count(counted, line_begin, '\n')); // only the stretch since the last hit
+					counted = line_begin;
+					hits[i] = {p_line_number, block_offset + static_cast<uint64_t>(line_begin - block.data()),
+							   std::string_view(line_begin, static_cast<size_t>(found[i].m_line_end - line_begin))};
+					line_zone.m_addBytes(hits[i].m_line.size());
+				}
+			}
+
+			profiler::Scope<stats::Zone::output> output_zone;
+			output_zone.m_countAs(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				if (!report(hits[i]))
+					return false;
+			}
+		}
+
+		profiler::Scope<stats::Zone::line> line_zone;
+		p_line_number += static_cast<uint64_t>(simd::count(counted, end, '\n'));
+		return true;
+	}
+
+	uint64_t m_lineNumber() const { return p_line_number; }
+
+  private:
+	const Matcher &p_matcher;
+	uint64_t p_line_number;
+};
+
+namespace scanner
+{
+// Counts matching lines of a block (up to "limit") without line numbers or line text, for -c/-l/-q.
+// stop() -> bool is checked after every hit.
+template <typename Stop>
+uint64_t countBlock(const Matcher &matcher, std::string_view block, uint64_t limit, Stop &&stop)
+{
+	profiler::Scope<stats::Zone::match> zone;
+	zone.m_addBytes(block.size());
+	const char *p = block.data();
+	const char *end = p + block.size();
+	uint64_t count = 0;
+	while (p < end && count < limit)
+	{
+		const char *hit = matcher.m_find(p, end);
+		if (hit == nullptr)
+			break;
+		count++;
+		if (stop())
+			break;
+		const char *line_end = static_cast<const char *>(::memchr(hit, '\n', static_cast<size_t>(end - hit)));
+		p = (line_end != nullptr) ? line_end + 1 : end;
+	}
+	return count;
+}
+
+// fn(std::string_view block, uint64_t block_offset) -> bool, returning false stops the scan
+// Walks [begin, end) of a regular file through mmap windows. Every block ends on a '\n' except the last one.
+// Returns false if a window couldn't be mapped.
+template <typename Fn>
+bool forEachMappedBlock(int fd, uint64_t begin, uint64_t end, Fn &&fn)
+{
+	MappedWindow window;
+	uint64_t pos = begin;
+	size_t window_size = WINDOW_SIZE;
+
+	while (pos < end)
+	{
+		uint64_t map_start = pos & ~(MappedWindow::m_pageSize() - 1);
+		uint64_t map_end = std::min<uint64_t>(end, map_start + window_size);
+		std::string_view view;
+		{
+			profiler::Scope<stats::Zone::read> zone;
+			view = window.m_map(fd, map_start, static_cast<size_t>(map_end - map_start));
+			zone.m_addBytes(view.size());
+		}
+		if (view.empty())
+			return false;
+
+		const char *first = view.data() + (pos - map_start);
+		const char *last = view.data() + view.size();
+		if (map_end < end)
+		{
+			const char *newline = static_cast<const char *>(::memrchr(first, '\n', static_cast<size_t>(last - first)));
+			if (newline == nullptr)
+			{
+				window_size *= 2; // a line longer than the window, grow until it fits
+				continue;
+			}
+			last = newline + 1;
+		}
+
+		if (!fn(std::string_view(first, static_cast<size_t>(last - first)), pos))
+			return true;
+
+		pos += static_cast<uint64_t>(last - first);
+		window_size = WINDOW_SIZE;
+	}
+	return true;
+}
+
+// Same as forEachMappedBlock but read()s from the current position of fd, works on pipes and special files
+template <typename Fn>
+bool forEachBufferedBlock(int fd, Fn &&fn)
+{
+	static thread_local std::vector<char> buffer; // reused, directory searches read lots of small files
+	if (buffer.size() < READ_BUFFER_SIZE)
+		buffer.resize(READ_BUFFER_SIZE);
+	size_t carry = 0; // bytes of an unfinished line at the start of the buffer
+	uint64_t offset = 0;
+
+	while (true)
+	{
+		if (carry == buffer.size())
+			buffer.resize(buffer.size() * 2);
+
+		ssize_t n;
+		{
+			profiler::Scope<stats::Zone::read> zone;
+			n = ::read(fd, buffer.data() + carry, buffer.size() - carry);
+			zone.m_addBytes(n > 0 ? static_cast<uint64_t>(n) : 0);
+		}
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		if (n == 0)
+		{
+			if (carry > 0)
+				fn(std::string_view(buffer.data(), carry), offset);
+			return true;
+		}
+
+		size_t filled = carry + static_cast<size_t>(n);
+		const char *newline = static_cast<const char *>(::memrchr(buffer.data() + carry, '\n', static_cast<size_t>(n)));
+		if (newline == nullptr)
+		{
+			carry = filled;
+			continue;
+		}
+
+		size_t block_length = static_cast<size_t>(newline + 1 - buffer.data());
+		if (!fn(std::string_view(buffer.data(), block_length), offset))
+			return true;
+
+		offset += block_length;
+		carry = filled - block_length;
+		std::memmove(buffer.data(), buffer.data() + block_length, carry);
+	}
+}
+
+// Picks mmap when the file allows it (and is big enough for it to pay off) and falls back to read() otherwise
+template <typename Fn>
+bool forEachBlock(InputFile &input, Fn &&fn)
+{
+	if (input.m_compression() != decompress::Compression::none)
+		return decompress::forEachBlock(input.m_fd(), input.m_size(), input.m_compression(), fn);
+	if (input.m_contents() != nullptr)
+	{
+		if (input.m_size() > 0)
+			fn(std::string_view(input.m_contents(), static_cast<size_t>(input.m_size())), 0);
+		return true;
+	}
+	if (input.m_isMappable() && input.m_size() > MMAP_THRESHOLD)
+	{
+		// only fall back if the very first window failed, otherwise blocks would be reported twice
+		bool started = false;
+		auto tracked = [&](std::string_view block, uint64_t offset) -> bool {
+			started = true;
+			return fn(block, offset);
+		};
+		bool ok = forEachMappedBlock(input.m_fd(), 0, input.m_size(), tracked);
+		if (ok || started)
+			return ok;
+		::lseek(input.m_fd(), 0, SEEK_SET);
+	}
+	return forEachBufferedBlock(input.m_fd(), fn);
+}
+
+// Searches a whole file on the calling thread, report(const ScanHit &) -> bool
+template <typename Report>
+bool searchFile(InputFile &input, const Matcher &matcher, Report &&report)
+{
+	LineSearcher searcher(matcher);
+	return forEachBlock(input, [&](std::string_view block, uint64_t offset) -> bool {
+		return searcher.m_searchBlock(block, offset, report);
+	});
+}
+// Counts the matching lines of a whole file, reading stops once "limit" lines matched or stop() -> bool says so
+template <typename Stop>
+bool countMatches(InputFile &input, const Matcher &matcher, uint64_t limit, uint64_t &count, Stop &&stop)
+{
+	count = 0;
+	if (limit == 0)
+		return true;
+	return forEachBlock(input, [&](std::string_view block, uint64_t) -> bool {
+		count += countBlock(matcher, block, limit - count, stop);
+		return count < limit && !stop();
+	});
+}
+} // namespace scanner
+
+#endif // scanner.hpp
@@ -0,0 +1,58 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <iostream>
+#include <string>
+
+#include "../libutils/src/profiler.hpp"
+#include "../libutils/src/timer.hpp"
+
+/* The phases --stats reports (see libutils/src/profiler.hpp):
+ *   open    opening a file, statx and its first 64KB (or waiting for the io_uring loader to hand it over)
+ *   read    read() calls, mapping windows and decompressing. Page faults of a mapped file land in match
+ *   match   the matcher going over blocks, hits are resolved inside it
+ *   line    working out a hit's line: its start and number (and transcoding it for UTF-16)
+ *   output  formatting the hits and writing them out
+ * line and output are timed per batch of hits (see LineSearcher), their calls are hits all the same.
+ * Without --stats each zone is a load and a branch. */
+
+namespace stats
+{
+enum class Zone : unsigned
+{
+	open,
+	read,
+	match,
+	line,
+	output,
+};
+
+inline constexpr const char *ZONE_NAMES[] = {"open", "read", "match", "line", "output"};
+
+// prints the zones to stderr when it goes out of scope, so it covers whatever is destroyed before it (the output sink)
+class Report
+{
+  public:
+	Report() = default;
+	Report(const Report &) = delete;
+	Report &operator=(const Report &) = delete;
+
+	~Report()
+	{
+		if (!profiler::isEnabled())
+			return;
+		const double wall = p_timer.m_elapsed();
+		std::cerr << "\n" << profiler::table(ZONE_NAMES);
+		std::cerr << "wall time " << static_cast<uint64_t>(wall * 1e3) << " ms (times are summed over threads)\n";
+	}
+
+  private:
+	Timer p_timer;
+};
+} // namespace stats
+
+#endif // stats.hpp
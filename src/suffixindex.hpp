@@ -0,0 +1,347 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef SUFFIXINDEX_HPP
+#define SUFFIXINDEX_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <span>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+
+#include <sys/mman.h>
+
+#include "matcher.hpp"
+#include "scanner.hpp"
+#include "walker.hpp"
+#include "../libutils/src/simd.hpp"
+#include "../libutils/src/binarycache.hpp"
+#include "../libutils/src/suffixarray.hpp"
+
+/* Suffix array of one huge file (txtfind --suffix-index FILE), for files that get searched over and over
+ * and only ever grow by appending (logs). It's stored next to the file as .txtfind-sa.NAME:
+ *   0 header, 1 suffix array (uint32_t, or uint64_t from 4GB on), 2 LCP (saturated at 255),
+ *   3 line samples (offset of every LINE_SAMPLE-th line start)
+ * A literal is two binary searches away, the LCP array extends the run of matching suffixes without
+ * touching the text, and the samples turn a hit's offset into a line number by counting newlines from
+ * the nearest sample. Lines appended after the build (the tail) are scanned like before.
+ * The array covers the file up to its last '\n' at build time. The sidecar is ignored once the file
+ * changed without growing (its size and mtime from the build), and when it grew, a fingerprint sampled
+ * across the covered part tells whether it was only appended to or rewritten. */
+
+namespace suffix
+{
+constexpr const char *SA_PREFIX = ".txtfind-sa.";
+constexpr uint32_t FORMAT_VERSION = 2;
+constexpr uint64_t LINE_SAMPLE = 256;
+constexpr size_t FINGERPRINT_BYTES = 4096;
+constexpr uint64_t FINGERPRINT_SAMPLES = 256; // 64 bytes each, spread evenly in between the head and the tail
+constexpr uint64_t MAX_HIT_DENSITY = 256; // more than a hit per 256 bytes and a plain scan is faster than jumping around
+
+struct SuffixHeader
+{
+	uint32_t m_version;
+	uint32_t m_index_width; // 4 or 8
+	uint64_t m_covered;		// bytes of the file in the array, always ends after a '\n'
+	uint64_t m_lines;		// newlines in the covered part
+	uint64_t m_line_sample;
+	uint64_t m_fingerprint;
+	uint64_t m_size; // of the whole file at build time
+	int64_t m_mtime;
+};
+
+struct BuildStats
+{
+	uint64_t m_covered = 0;
+	uint64_t m_lines = 0;
+	uint64_t m_index_bytes = 0;
+};
+
+inline std::string sidecarPath(const std::string &path)
+{
+	return walker::sidecarPath(path, SA_PREFIX);
+}
+
+/* FNV-1a over the first and last FINGERPRINT_BYTES of the covered part and FINGERPRINT_SAMPLES pieces of
+ * what's in between, appending doesn't change it. An edit in the middle of a big file can still slip through
+ * the samples, that's what the size and mtime check is for: it only gets here when the file grew. */
+inline uint64_t fingerprint(const char *text, uint64_t covered)
+{
+	constexpr uint64_t SAMPLE_BYTES = 64;
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&](const char *begin, const char *end) {
+		for (const char *p = begin; p < end; ++p)
+			hash = (hash ^ static_cast<uint8_t>(*p)) * 1099511628211ull;
+	};
+	const size_t head = static_cast<size_t>(std::min<uint64_t>(covered, FINGERPRINT_BYTES));
+	mix(text, text + head);
+	mix(text + covered - head, text + covered);
+	if (covered > 2 * FINGERPRINT_BYTES + SAMPLE_BYTES)
+	{
+		const uint64_t stride = (covered - 2 * FINGERPRINT_BYTES - SAMPLE_BYTES) / FINGERPRINT_SAMPLES;
+		for (uint64_t i = 0; i < FINGERPRINT_SAMPLES; i++)
+		{
+			const char *sample = text + FINGERPRINT_BYTES + i * stride;
+			mix(sample, sample + SAMPLE_BYTES);
+		}
+	}
+	return hash ^ covered;
+}
+
+// Builds the sidecar of "path", throws std::runtime_error if the file can't be mapped or the sidecar written
+inline BuildStats buildSuffixIndex(const std::string &path)
+{
+	InputFile input;
+	if (!input.m_open(path) || !input.m_isMappable())
+		throw std::runtime_error("Can't map '" + path + "', only regular files can get a suffix array");
+	MappedWindow window;
+	const std::string_view file = window.m_map(input.m_fd(), 0, static_cast<size_t>(input.m_size()));
+	if (file.empty())
+		throw std::runtime_error("Failed to map '" + path + "'");
+
+	const char *last_newline = static_cast<const char *>(::memrchr(file.data(), '\n', file.size()));
+	if (last_newline == nullptr)
+		throw std::runtime_error("'" + path + "' has no complete line to index");
+
+	BuildStats stats;
+	stats.m_covered = static_cast<uint64_t>(last_newline + 1 - file.data());
+	const char *text = file.data();
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(text);
+	const size_t covered = static_cast<size_t>(stats.m_covered);
+
+	std::vector<uint64_t> samples = {0};
+	for (const char *p = text; (p = static_cast<const char *>(std::memchr(p, '\n', covered - static_cast<size_t>(p - text)))) != nullptr; ++p)
+	{
+		if (++stats.m_lines % LINE_SAMPLE == 0 && p + 1 < text + covered)
+			samples.push_back(static_cast<uint64_t>(p + 1 - text));
+	}
+
+	auto write = [&](const auto &sa) {
+		using Index = typename std::decay_t<decltype(sa)>::value_type;
+		if (sa.size() != covered)
+			throw std::runtime_error("Failed to build the suffix array of '" + path + "'");
+		const std::vector<uint8_t> lcp = suffixarray::buildLcp(bytes, covered, sa);
+		const std::vector<SuffixHeader> header = {{FORMAT_VERSION, static_cast<uint32_t>(sizeof(Index)), stats.m_covered, stats.m_lines, LINE_SAMPLE,
+												   fingerprint(text, stats.m_covered), input.m_size(), input.m_mtime()}};
+		BinaryCache::SectionWriter writer;
+		writer.add(header);
+		writer.add(sa);
+		writer.add(lcp);
+		writer.add(samples);
+		writer.save(sidecarPath(path));
+	};
+	if (stats.m_covered < UINT32_MAX)
+		write(suffixarray::build<uint32_t>(bytes, covered));
+	else
+		write(suffixarray::build<uint64_t>(bytes, covered));
+
+	struct stat st;
+	if (::stat(sidecarPath(path).c_str(), &st) == 0)
+		stats.m_index_bytes = static_cast<uint64_t>(st.st_size);
+	return stats;
+}
+
+class SuffixIndex
+{
+  public:
+	SuffixIndex() = default;
+	~SuffixIndex() { p_unmap(); }
+	SuffixIndex(const SuffixIndex &) = delete;
+	SuffixIndex &operator=(const SuffixIndex &) = delete;
+
+	// false when the file has no sidecar, or it doesn't belong to what the file is now
+	bool m_open(const std::string &path, const InputFile &input)
+	{
+		try
+		{
+			p_sections = std::make_unique<BinaryCache::MappedSections>(sidecarPath(path));
+			const auto header = p_sections->get<SuffixHeader>(0);
+			if (header.size() != 1 || header[0].m_version != FORMAT_VERSION || header[0].m_line_sample == 0 ||
+				header[0].m_covered == 0 || header[0].m_covered > input.m_size())
+				return p_fail();
+			const bool unchanged = header[0].m_size == input.m_size() && header[0].m_mtime == input.m_mtime();
+			if (!unchanged && input.m_size() <= header[0].m_size)
+				return p_fail(); // changed without growing, so it wasn't (only) appended to
+			p_header = header[0];
+			if (p_header.m_index_width == 4)
+				p_sa32 = p_sections->get<uint32_t>(1);
+			else if (p_header.m_index_width == 8)
+				p_sa64 = p_sections->get<uint64_t>(1);
+			else
+				return p_fail();
+			p_lcp = p_sections->get<uint8_t>(2);
+			p_samples = p_sections->get<uint64_t>(3);
+		}
+		catch (const std::exception &)
+		{
+			return p_fail();
+		}
+		if (p_lcp.size() != p_header.m_covered || p_sa32.size() + p_sa64.size() != p_header.m_covered || p_samples.empty())
+			return p_fail();
+
+		// the lookups jump all over the file, readahead would only waste I/O
+		void *addr = ::mmap(nullptr, static_cast<size_t>(p_header.m_covered), PROT_READ, MAP_PRIVATE, input.m_fd(), 0);
+		if (addr == MAP_FAILED)
+			return p_fail();
+		::madvise(addr, static_cast<size_t>(p_header.m_covered), MADV_RANDOM);
+		p_text = std::string_view(static_cast<const char *>(addr), static_cast<size_t>(p_header.m_covered));
+		if (fingerprint(p_text.data(), p_header.m_covered) != p_header.m_fingerprint)
+			return p_fail(); // grew, but what was there got rewritten too
+		return true;
+	}
+
+	uint64_t m_covered() const { return p_header.m_covered; }
+	uint64_t m_lines() const { return p_header.m_lines; }
+	std::string_view m_text() const { return p_text; }
+
+	/* Start offsets of the covered lines containing one of "literals", sorted. Returns false when the index
+	 * can't help: an empty literal, or so many hits that scanning the file is cheaper. */
+	bool m_candidateLines(const std::vector<std::string> &literals, std::vector<uint64_t> &lines) const
+	{
+		lines.clear();
+		if (literals.empty())
+			return false;
+		const uint64_t budget = p_header.m_covered / MAX_HIT_DENSITY + 1;
+		std::vector<uint64_t> positions;
+		for (const std::string &literal : literals)
+		{
+			if (literal.empty())
+				return false;
+			const bool ok = p_sa32.empty() ? p_find(p_sa64, literal, positions, budget) : p_find(p_sa32, literal, positions, budget);
+			if (!ok)
+				return false;
+		}
+
+		std::sort(positions.begin(), positions.end());
+		for (uint64_t position : positions)
+		{
+			if (!lines.empty() && position < p_lineEnd(lines.back()))
+				continue; // same line as the previous hit
+			const char *newline = static_cast<const char *>(::memrchr(p_text.data(), '\n', static_cast<size_t>(position)));
+			lines.push_back(newline == nullptr ? 0 : static_cast<uint64_t>(newline + 1 - p_text.data()));
+		}
+		return true;
+	}
+
+	// Line numbers for increasing line offsets: counts newlines from the nearest sample or the previous line, whichever is closer
+	class LineResolver
+	{
+	  public:
+		explicit LineResolver(const SuffixIndex &index) : p_index(index) {}
+
+		uint64_t m_lineNumber(uint64_t offset)
+		{
+			const auto samples = p_index.p_samples;
+			const size_t sample = static_cast<size_t>(std::upper_bound(samples.begin(), samples.end(), offset) - samples.begin()) - 1;
+			if (samples[sample] > p_offset)
+			{
+				p_offset = samples[sample];
+				p_line = sample * p_index.p_header.m_line_sample + 1;
+			}
+			const char *text = p_index.p_text.data();
+			p_line += simd::count(text + p_offset, text + offset, '\n');
+			p_offset = offset;
+			return p_line;
+		}
+
+	  private:
+		const SuffixIndex &p_index;
+		uint64_t p_offset = 0;
+		uint64_t p_line = 1;
+	};
+
+  private:
+	std::unique_ptr<BinaryCache::MappedSections> p_sections;
+	SuffixHeader p_header = {};
+	std::span<const uint32_t> p_sa32;
+	std::span<const uint64_t> p_sa64;
+	std::span<const uint8_t> p_lcp;
+	std::span<const uint64_t> p_samples;
+	std::string_view p_text;
+
+	template <typename Array>
+	bool p_find(const Array &sa, std::string_view literal, std::vector<uint64_t> &positions, uint64_t budget) const
+	{
+		const size_t first = suffixarray::lowerBound(p_text, sa, literal);
+		size_t last = first;
+		if (literal.size() <= 255)
+		{
+			// lcp[i] >= length: suffix i starts with the same "length" bytes as suffix i - 1, no text access needed
+			if (first < sa.size() && suffixarray::detail::comparePrefix(p_text, sa[first], literal) == 0)
+			{
+				last = first + 1;
+				while (last < sa.size() && p_lcp[last] >= literal.size() && last - first <= budget)
+					last++;
+			}
+		}
+		else
+			last = suffixarray::upperBound(p_text, sa, literal, first);
+
+		if (positions.size() + (last - first) > budget)
+			return false;
+		for (size_t i = first; i < last; i++)
+			positions.push_back(sa[i]);
+		return true;
+	}
+
+	uint64_t p_lineEnd(uint64_t line) const
+	{
+		const void *newline = std::memchr(p_text.data() + line, '\n', static_cast<size_t>(p_header.m_covered - line));
+		return static_cast<uint64_t>(static_cast<const char *>(newline) - p_text.data()); // covered always ends with '\n'
+	}
+
+	bool p_fail()
+	{
+		p_unmap();
+		p_sections.reset();
+		p_sa32 = {};
+		p_sa64 = {};
+		return false;
+	}
+
+	void p_unmap()
+	{
+		if (!p_text.empty())
+			::munmap(const_cast<char *>(p_text.data()), p_text.size());
+		p_text = {};
+	}
+};
+
+/* Searches the candidate lines (see SuffixIndex::m_candidateLines) with the matcher, then the tail appended
+ * since the build. report(const ScanHit &) -> bool like LineSearcher, without line_numbers every hit's
+ * line number is 0 (for -c/-l/-q). Returns false if the tail couldn't be read. */
+template <typename Report>
+bool searchFile(InputFile &input, const SuffixIndex &index, const Matcher &matcher, const std::vector<uint64_t> &lines, bool line_numbers, Report &&report)
+{
+	const std::string_view text = index.m_text();
+	SuffixIndex::LineResolver resolver(index);
+	profiler::Scope<stats::Zone::match> zone; // the candidate lines all in one, they're only a few hundred bytes each
+	zone.m_countAs(lines.size());
+	for (uint64_t line : lines)
+	{
+		const char *begin = text.data() + line;
+		const char *end = static_cast<const char *>(std::memchr(begin, '\n', text.size() - line));
+		if (matcher.m_find(begin, end) == nullptr)
+			continue; // the literal is there, the regex (or the rest of -f's pattern) doesn't match
+		const ScanHit hit{line_numbers ? resolver.m_lineNumber(line) : 0, line, std::string_view(begin, static_cast<size_t>(end - begin))};
+		if (!report(hit))
+			return true;
+	}
+
+	if (input.m_size() == index.m_covered())
+		return true;
+	LineSearcher searcher(matcher, index.m_lines() + 1);
+	return scanner::forEachMappedBlock(input.m_fd(), index.m_covered(), input.m_size(), [&](std::string_view block, uint64_t offset) -> bool {
+		return searcher.m_searchBlock(block, offset, report);
+	});
+}
+} // namespace suffix
+
+#endif // suffixindex.hpp
@@ -0,0 +1,526 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef URING_HPP
+#define URING_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+
+/* Loading lots of small files through io_uring, for directory searches.
+ * A loader thread keeps QUEUE_DEPTH files in flight: openat and statx go in together, once both are
+ * back a file that fits gets read into its slot's buffer (registered with the ring, so the kernel
+ * doesn't map it again on every read). The search threads then find the whole file in memory, and the
+ * loader closes it through the ring when they're done. Syscalls get batched, one io_uring_enter per
+ * round trip for the whole queue, instead of open/fstat/read/read/close per file.
+ * Talks to the kernel with raw syscalls (no liburing). When the ring can't be set up (old kernel,
+ * io_uring disabled, seccomp...) FileLoader::m_start says so and files get opened and read as usual. */
+
+namespace uring
+{
+constexpr unsigned QUEUE_DEPTH = 64;					// files in flight
+constexpr size_t BUFFER_SIZE = size_t(128) << 10;		// bigger files are handed over open but unread
+constexpr unsigned RING_ENTRIES = QUEUE_DEPTH * 4;		// openat + statx per file, plus the closes
+
+// Minimal io_uring: mapped submission/completion rings, no SQPOLL
+class Ring
+{
+  public:
+	Ring() = default;
+	~Ring()
+	{
+		if (p_sqes != nullptr)
+			::munmap(p_sqes, p_sqes_size);
+		if (p_cq_ptr != nullptr && p_cq_ptr != p_sq_ptr)
+			::munmap(p_cq_ptr, p_cq_size);
+		if (p_sq_ptr != nullptr)
+			::munmap(p_sq_ptr, p_sq_size);
+		if (p_fd >= 0)
+			::close(p_fd);
+	}
+
+	Ring(const Ring &) = delete;
+	Ring &operator=(const Ring &) = delete;
+
+	bool m_setup(unsigned entries)
+	{
+		io_uring_params params = {};
+		p_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+		if (p_fd < 0)
+			return false;
+
+		p_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		p_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (single_mmap)
+			p_sq_size = p_cq_size = std::max(p_sq_size, p_cq_size);
+
+		p_sq_ptr = p_map(p_sq_size, IORING_OFF_SQ_RING);
+		p_cq_ptr = single_mmap ? p_sq_ptr : p_map(p_cq_size, IORING_OFF_CQ_RING);
+		p_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+		p_sqes = static_cast<io_uring_sqe *>(p_map(p_sqes_size, IORING_OFF_SQES));
+		if (p_sq_ptr == nullptr || p_cq_ptr == nullptr || p_sqes == nullptr)
+			return false;
+
+		char *sq = static_cast<char *>(p_sq_ptr);
+		p_sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+		p_sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+		p_sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+		p_sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+		p_sq_entries = params.sq_entries;
+		char *cq = static_cast<char *>(p_cq_ptr);
+		p_cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+		p_cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+		p_cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+		p_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+		p_local_tail = *p_sq_tail;
+		return true;
+	}
+
+	// true if the kernel knows every one of "ops"
+	bool m_supports(std::initializer_list<unsigned> ops) const
+	{
+		const size_t size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+		std::vector<uint64_t> storage((size + 7) / 8, 0);
+		auto *probe = reinterpret_cast<io_uring_probe *>(storage.data());
+		if (::syscall(__NR_io_uring_register, p_fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+			return false;
+		return std::all_of(ops.begin(), ops.end(), [&](unsigned op) {
+			return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+		});
+	}
+
+	bool m_registerBuffers(const std::vector<iovec> &buffers)
+	{
+		return ::syscall(__NR_io_uring_register, p_fd, IORING_REGISTER_BUFFERS, buffers.data(), buffers.size()) == 0;
+	}
+
+	// a zeroed SQE to fill in, it goes out with the next m_submit. nullptr when the queue is full
+	io_uring_sqe *m_sqe()
+	{
+		const unsigned head = std::atomic_ref<unsigned>(*p_sq_head).load(std::memory_order_acquire);
+		if (p_local_tail - head >= p_sq_entries)
+			return nullptr;
+		const unsigned index = p_local_tail & p_sq_mask;
+		io_uring_sqe *sqe = &p_sqes[index];
+		*sqe = {};
+		p_sq_array[index] = index;
+		p_local_tail++;
+		p_queued++;
+		return sqe;
+	}
+
+	// submits the queued SQEs and waits until at least "wait" completions are there
+	bool m_submit(unsigned wait)
+	{
+		std::atomic_ref<unsigned>(*p_sq_tail).store(p_local_tail, std::memory_order_release);
+		for (;;)
+		{
+			const long result = ::syscall(__NR_io_uring_enter, p_fd, p_queued, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+			if (result >= 0)
+			{
+				p_queued -= std::min<unsigned>(p_queued, static_cast<unsigned>(result));
+				return true;
+			}
+			if (errno != EINTR)
+				return errno == EAGAIN || errno == EBUSY; // completions have to be reaped first
+		}
+	}
+
+	// fn(const io_uring_cqe &) for every completion there is
+	template <typename Fn>
+	void m_reap(Fn &&fn)
+	{
+		unsigned head = *p_cq_head;
+		const unsigned tail = std::atomic_ref<unsigned>(*p_cq_tail).load(std::memory_order_acquire);
+		for (; head != tail; head++)
+			fn(p_cqes[head & p_cq_mask]);
+		std::atomic_ref<unsigned>(*p_cq_head).store(head, std::memory_order_release);
+	}
+
+  private:
+	int p_fd = -1;
+	void *p_sq_ptr = nullptr, *p_cq_ptr = nullptr;
+	size_t p_sq_size = 0, p_cq_size = 0, p_sqes_size = 0;
+	io_uring_sqe *p_sqes = nullptr;
+	unsigned *p_sq_head = nullptr, *p_sq_tail = nullptr, *p_sq_array = nullptr;
+	unsigned p_sq_mask = 0, p_sq_entries = 0;
+	unsigned *p_cq_head = nullptr, *p_cq_tail = nullptr;
+	unsigned p_cq_mask = 0;
+	io_uring_cqe *p_cqes = nullptr;
+	unsigned p_local_tail = 0; // SQEs written, published to the kernel on m_submit
+	unsigned p_queued = 0;
+
+	void *p_map(size_t size, uint64_t offset)
+	{
+		void *addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, p_fd, static_cast<off_t>(offset));
+		return addr == MAP_FAILED ? nullptr : addr;
+	}
+};
+
+class FileLoader;
+
+// A file the loader has opened (and read, if it fit), its slot goes back to the loader once this is destroyed
+class LoadedFile
+{
+  public:
+	LoadedFile() = default;
+	~LoadedFile() { m_release(); }
+
+	LoadedFile(const LoadedFile &) = delete;
+	LoadedFile &operator=(const LoadedFile &) = delete;
+
+	int m_fd() const { return p_fd; }
+	const struct stat &m_stat() const { return p_stat; }
+	// the whole file, nullptr when it was too big for a buffer and has to be read from m_fd()
+	const char *m_contents() const { return p_contents; }
+
+	void m_release();
+
+  private:
+	friend class FileLoader;
+	FileLoader *p_loader = nullptr;
+	unsigned p_slot = 0;
+	int p_fd = -1;
+	struct stat p_stat = {};
+	const char *p_contents = nullptr;
+};
+
+/* Loads the files of "paths" in order, ahead of the search threads. A search thread asks for file i with
+ * m_take and gets it once it's loaded. If i is far beyond what the loader has got to (a task stolen from the
+ * back of the list) m_take returns false instead, the thread opens that one itself and the loader skips it. */
+class FileLoader
+{
+  public:
+	FileLoader() = default;
+	~FileLoader() { m_stop(); }
+
+	FileLoader(const FileLoader &) = delete;
+	FileLoader &operator=(const FileLoader &) = delete;
+
+	// false when io_uring can't be used here, nothing has been started then. "paths" has to outlive the loader
+	bool m_start(const std::vector<const char *> &paths)
+	{
+		if (!p_ring.m_setup(RING_ENTRIES) ||
+			!p_ring.m_supports({IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ_FIXED, IORING_OP_READ, IORING_OP_CLOSE}))
+			return false;
+		p_memory = static_cast<char *>(std::aligned_alloc(4096, QUEUE_DEPTH * BUFFER_SIZE));
+		if (p_memory == nullptr)
+			return false;
+		std::vector<iovec> buffers(QUEUE_DEPTH);
+		for (unsigned i = 0; i < QUEUE_DEPTH; i++)
+			buffers[i] = {p_memory + i * BUFFER_SIZE, BUFFER_SIZE};
+		p_fixed = p_ring.m_registerBuffers(buffers); // can fail on RLIMIT_MEMLOCK, plain reads into the same buffers then
+
+		p_paths = &paths;
+		p_states.assign(paths.size(), State::waiting);
+		p_slot_of.assign(paths.size(), 0);
+		p_slots.assign(QUEUE_DEPTH, Slot{});
+		for (unsigned i = QUEUE_DEPTH; i-- > 0;)
+			p_free.push_back(i);
+		p_thread = std::thread([this]() { p_run(); });
+		return true;
+	}
+
+	// file "index" of the paths, false if the caller has to open it itself
+	bool m_take(size_t index, LoadedFile &file)
+	{
+		std::unique_lock<std::mutex> lock(p_mutex);
+		if (p_states[index] == State::waiting && index >= p_next + QUEUE_DEPTH) // too far ahead to wait for
+		{
+			p_states[index] = State::claimed;
+			return false;
+		}
+		p_waiting++;
+		p_loaded.wait(lock, [&] { return p_states[index] != State::waiting && p_states[index] != State::loading; });
+		p_waiting--;
+		if (p_states[index] != State::ready)
+			return false;
+		p_states[index] = State::taken;
+
+		const unsigned slot_index = p_slot_of[index];
+		const Slot &slot = p_slots[slot_index];
+		file.m_release();
+		file.p_loader = this;
+		file.p_slot = slot_index;
+		file.p_fd = slot.m_fd;
+		file.p_stat = {};
+		file.p_stat.st_mode = slot.m_statx.stx_mode;
+		file.p_stat.st_size = static_cast<off_t>(slot.m_statx.stx_size);
+		file.p_stat.st_mtime = static_cast<time_t>(slot.m_statx.stx_mtime.tv_sec);
+		file.p_contents = slot.m_whole ? p_memory + slot_index * BUFFER_SIZE : nullptr;
+		return true;
+	}
+
+	// waits for what's in flight and closes everything that's still open
+	void m_stop()
+	{
+		if (!p_thread.joinable())
+			return;
+		{
+			std::lock_guard<std::mutex> lock(p_mutex);
+			p_stopping = true;
+		}
+		p_changed.notify_all();
+		p_thread.join();
+		std::free(p_memory);
+		p_memory = nullptr;
+	}
+
+  private:
+	friend class LoadedFile;
+
+	enum class State : uint8_t
+	{
+		waiting, // not submitted yet
+		claimed, // a search thread opens it itself
+		loading,
+		ready,
+		failed,
+		taken,
+	};
+	enum Op : uint64_t
+	{
+		OP_OPEN,
+		OP_STAT,
+		OP_READ,
+		OP_CLOSE,
+	};
+
+	struct Slot
+	{
+		size_t m_index = 0;
+		int m_fd = -1;
+		int m_open_result = 0;
+		int m_stat_result = 0;
+		unsigned m_pending = 0; // openat/statx not back yet
+		bool m_whole = false;
+		struct statx m_statx = {};
+	};
+
+	Ring p_ring;
+	bool p_fixed = false;
+	char *p_memory = nullptr;
+	const std::vector<const char *> *p_paths = nullptr;
+	std::vector<State> p_states;
+	std::vector<unsigned> p_slot_of;
+	std::vector<Slot> p_slots;
+	std::vector<unsigned> p_free;	  // loader thread only
+	std::vector<unsigned> p_released; // handed back by search threads, to be closed
+	std::vector<std::pair<size_t, State>> p_finished; // loader thread only
+	size_t p_next = 0;								  // the next file to submit
+	unsigned p_waiting = 0;							  // search threads in m_take
+	bool p_idle = false;							  // the loader sleeps on p_changed
+	bool p_stopping = false;
+	unsigned p_inflight = 0; // loader thread only
+	std::thread p_thread;
+	std::mutex p_mutex;
+	std::condition_variable p_changed, p_loaded;
+
+	void p_release(unsigned slot)
+	{
+		bool wake;
+		{
+			std::lock_guard<std::mutex> lock(p_mutex);
+			p_released.push_back(slot);
+			wake = p_idle;
+		}
+		if (wake) // a futex call per file would cost about as much as the syscalls the ring saves
+			p_changed.notify_all();
+	}
+
+	void p_queue(Op op, unsigned slot, int fd, const void *addr, unsigned length, uint64_t offset)
+	{
+		io_uring_sqe *sqe = p_ring.m_sqe();
+		while (sqe == nullptr) // can't happen with RING_ENTRIES, a full SQ just gets flushed
+		{
+			p_ring.m_submit(0);
+			sqe = p_ring.m_sqe();
+		}
+		sqe->fd = fd;
+		sqe->addr = reinterpret_cast<uint64_t>(addr);
+		sqe->len = length;
+		sqe->off = offset;
+		sqe->user_data = (static_cast<uint64_t>(slot) << 8) | op;
+		p_inflight++;
+		switch (op)
+		{
+		case OP_OPEN:
+			sqe->opcode = IORING_OP_OPENAT;
+			sqe->open_flags = O_RDONLY | O_CLOEXEC | O_NOCTTY;
+			break;
+		case OP_STAT:
+			sqe->opcode = IORING_OP_STATX;
+			sqe->statx_flags = AT_SYMLINK_NOFOLLOW | AT_STATX_SYNC_AS_STAT;
+			break;
+		case OP_READ:
+			sqe->opcode = p_fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+			sqe->buf_index = static_cast<uint16_t>(p_fixed ? slot : 0);
+			break;
+		case OP_CLOSE:
+			sqe->opcode = IORING_OP_CLOSE;
+			break;
+		}
+	}
+
+	// published to the search threads once per batch of completions
+	void p_finish(unsigned slot_index, State state)
+	{
+		Slot &slot = p_slots[slot_index];
+		p_finished.push_back({slot.m_index, state});
+		if (state == State::failed)
+		{
+			if (slot.m_fd >= 0)
+				p_queue(OP_CLOSE, slot_index, slot.m_fd, nullptr, 0, 0);
+			slot.m_fd = -1;
+			p_free.push_back(slot_index);
+		}
+	}
+
+	void p_complete(const io_uring_cqe &cqe)
+	{
+		p_inflight--;
+		const Op op = static_cast<Op>(cqe.user_data & 0xFF);
+		const unsigned slot_index = static_cast<unsigned>(cqe.user_data >> 8);
+		Slot &slot = p_slots[slot_index];
+		if (op == OP_CLOSE)
+			return;
+		if (op == OP_READ)
+		{
+			// the size statx saw, or the file changed in between and gets read the usual way
+			slot.m_whole = cqe.res >= 0 && static_cast<uint64_t>(cqe.res) == slot.m_statx.stx_size;
+			p_finish(slot_index, State::ready);
+			return;
+		}
+
+		if (op == OP_OPEN)
+		{
+			slot.m_open_result = cqe.res;
+			slot.m_fd = cqe.res >= 0 ? cqe.res : -1;
+		}
+		else
+			slot.m_stat_result = cqe.res;
+		if (--slot.m_pending > 0)
+			return;
+
+		// both are back: anything but a regular file is left to the usual path
+		if (slot.m_open_result < 0 || slot.m_stat_result < 0 || !S_ISREG(slot.m_statx.stx_mode))
+			p_finish(slot_index, State::failed);
+		else if (slot.m_statx.stx_size == 0 || slot.m_statx.stx_size > BUFFER_SIZE)
+		{
+			slot.m_whole = slot.m_statx.stx_size == 0;
+			p_finish(slot_index, State::ready);
+		}
+		else
+			p_queue(OP_READ, slot_index, slot.m_fd, p_memory + slot_index * BUFFER_SIZE, static_cast<unsigned>(BUFFER_SIZE), 0);
+	}
+
+	void p_run()
+	{
+		const size_t count = p_paths->size();
+		size_t &next = p_next; // only changes under p_mutex
+		std::vector<unsigned> released;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(p_mutex);
+				if (p_inflight == 0) // nothing will complete, the next thing has to come from the search threads
+				{
+					p_idle = true;
+					p_changed.wait(lock, [&] { return p_stopping || !p_released.empty() || (next < count && !p_free.empty()); });
+					p_idle = false;
+				}
+				released.swap(p_released);
+				if (p_stopping)
+				{
+					next = count;
+					for (size_t s = 0; s < p_slots.size(); s++) // loaded but never taken
+					{
+						Slot &slot = p_slots[s];
+						if (slot.m_fd >= 0 && p_states[slot.m_index] == State::ready)
+						{
+							p_states[slot.m_index] = State::failed;
+							released.push_back(static_cast<unsigned>(s));
+						}
+					}
+				}
+				for (; next < count && !p_free.empty(); next++)
+				{
+					if (p_states[next] != State::waiting)
+						continue;
+					p_states[next] = State::loading;
+					const unsigned slot_index = p_free.back();
+					p_free.pop_back();
+					p_slot_of[next] = slot_index;
+					Slot &slot = p_slots[slot_index];
+					slot = Slot{};
+					slot.m_index = next;
+					slot.m_pending = 2;
+					const char *path = (*p_paths)[next];
+					p_queue(OP_OPEN, slot_index, AT_FDCWD, path, 0, 0);
+					p_queue(OP_STAT, slot_index, AT_FDCWD, path, STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME,
+							reinterpret_cast<uint64_t>(&slot.m_statx));
+				}
+			}
+			for (unsigned slot : released)
+			{
+				p_queue(OP_CLOSE, slot, p_slots[slot].m_fd, nullptr, 0, 0);
+				p_slots[slot].m_fd = -1;
+				p_free.push_back(slot);
+			}
+			released.clear();
+
+			if (p_inflight == 0 && next == count && p_free.size() == QUEUE_DEPTH)
+				return;
+			if (p_inflight > 0)
+			{
+				p_ring.m_submit(1);
+				p_ring.m_reap([&](const io_uring_cqe &cqe) { p_complete(cqe); });
+			}
+			if (!p_finished.empty())
+			{
+				bool wake;
+				{
+					std::lock_guard<std::mutex> lock(p_mutex);
+					for (const auto &[index, state] : p_finished)
+						p_states[index] = state;
+					wake = p_waiting > 0;
+				}
+				p_finished.clear();
+				if (wake)
+					p_loaded.notify_all();
+			}
+		}
+	}
+};
+
+inline void LoadedFile::m_release()
+{
+	if (p_loader != nullptr)
+		p_loader->p_release(p_slot);
+	p_loader = nullptr;
+	p_fd = -1;
+	p_contents = nullptr;
+}
+} // namespace uring
+
+#endif // uring.hpp
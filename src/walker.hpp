@@ -0,0 +1,104 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef WALKER_HPP
+#define WALKER_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "workpool.hpp"
+
+struct FileEntry
+{
+	std::string m_path;
+	uint64_t m_size;
+	int64_t m_mtime; // seconds
+};
+
+/* Parallel version of File::m_listfiles_recursive for txtfind:
+ * every directory is a task on a WorkStealingPool, so big subtrees get spread over all workers.
+ * d_type from readdir() tells files and directories apart without a stat(), and the size comes
+ * from fstatat() relative to the open directory instead of resolving the whole path again. */
+
+namespace walker
+{
+inline std::string joinPath(const std::string &dir, const char *name)
+{
+	std::string path;
+	path.reserve(dir.size() + std::strlen(name) + 1);
+	path += dir;
+	if (path.empty() || path.back() != '/')
+		path += '/';
+	path += name;
+	return path;
+}
+
+// "prefix" + the file's name, in the same directory: where txtfind keeps its per-file sidecars (.txtfind-sa.NAME...)
+inline std::string sidecarPath(const std::string &path, const char *prefix)
+{
+	const size_t slash = path.find_last_of('/');
+	if (slash == std::string::npos)
+		return prefix + path;
+	return path.substr(0, slash + 1) + prefix + path.substr(slash + 1);
+}
+
+// every regular file under root, biggest first. Symlinks aren't followed, unreadable directories are skipped
+inline std::vector<FileEntry> listFiles(const std::string &root, unsigned threads)
+{
+	WorkStealingPool<std::string> pool(threads);
+	std::vector<std::vector<FileEntry>> found(pool.m_threads()); // one list per worker, so no locking
+
+	pool.m_push(0, root);
+	pool.m_run([&](std::string &dir, unsigned worker) {
+		DIR *handle = ::opendir(dir.c_str());
+		if (handle == nullptr)
+			return;
+		const int dir_fd = ::dirfd(handle);
+
+		while (const dirent *entry = ::readdir(handle))
+		{
+			const char *name = entry->d_name;
+			if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+				continue;
+
+			if (entry->d_type == DT_DIR)
+			{
+				pool.m_push(worker, joinPath(dir, name));
+				continue;
+			}
+			if (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN) // symlinks, sockets, fifos...
+				continue;
+
+			struct stat st;
+			if (::fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+				continue;
+			if (S_ISDIR(st.st_mode))
+				pool.m_push(worker, joinPath(dir, name)); // DT_UNKNOWN on some filesystems
+			else if (S_ISREG(st.st_mode))
+				found[worker].push_back({joinPath(dir, name), static_cast<uint64_t>(st.st_size), static_cast<int64_t>(st.st_mtime)});
+		}
+		::closedir(handle);
+	});
+
+	std::vector<FileEntry> files;
+	for (auto &list : found)
+	{
+		files.insert(files.end(), std::make_move_iterator(list.begin()), std::make_move_iterator(list.end()));
+	}
+	std::sort(files.begin(), files.end(), [](const FileEntry &lhs, const FileEntry &rhs) {
+		return lhs.m_size != rhs.m_size ? lhs.m_size > rhs.m_size : lhs.m_path < rhs.m_path;
+	});
+	return files;
+}
+} // namespace walker
+
+#endif // walker.hpp
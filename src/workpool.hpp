@@ -0,0 +1,142 @@
+/* Part of https://github.com/HassanIQ777/txtfind
+Made on:     2026-Oct-17
+Last update: 2026-Oct-17 */
+
+#ifndef WORKPOOL_HPP
+#define WORKPOOL_HPP
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+/* Work-stealing pool: every worker owns a deque, takes work from its front and,
+ * once it runs dry, steals from the back of the other workers' deques.
+ * Tasks can push more tasks while they run (directory walking does that), the pool
+ * finishes when every pushed task has run. A worker with nothing to take sleeps until a task is pushed
+ * or the last one finishes, instead of spinning while the others walk a deep tree or search a big file. */
+
+template <typename Task>
+class WorkStealingPool
+{
+  public:
+	explicit WorkStealingPool(unsigned threads)
+	{
+		for (unsigned i = 0; i < std::max(1u, threads); i++)
+			p_queues.push_back(std::make_unique<Queue>());
+	}
+
+	unsigned m_threads() const { return static_cast<unsigned>(p_queues.size()); }
+
+	// worker = the queue the task goes to, inside a task pass the worker index you got
+	void m_push(unsigned worker, Task task)
+	{
+		p_pending.fetch_add(1);
+		Queue &queue = *p_queues[worker % p_queues.size()];
+		{
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			queue.m_tasks.push_back(std::move(task));
+		}
+		p_wake(false);
+	}
+
+	// fn(Task &, unsigned worker), the calling thread works as worker 0
+	template <typename Fn>
+	void m_run(Fn &&fn)
+	{
+		auto work = [&](unsigned worker) {
+			Task task;
+			while (!p_cancelled.load(std::memory_order_relaxed))
+			{
+				const uint64_t seen = p_signals.load(); // before looking, so a push that comes after can't be missed
+				if (p_popOwn(worker, task) || p_steal(worker, task))
+				{
+					fn(task, worker);
+					if (p_pending.fetch_sub(1) == 1)
+						p_wake(true); // that was the last one, the sleepers can go home
+					continue;
+				}
+				if (p_pending.load() == 0)
+					break;
+				std::unique_lock<std::mutex> lock(p_idle_mutex);
+				p_sleepers.fetch_add(1);
+				p_idle.wait(lock, [&] { return p_signals.load() != seen || p_pending.load() == 0 || p_cancelled.load(); });
+				p_sleepers.fetch_sub(1);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned i = 1; i < m_threads(); i++)
+			threads.emplace_back(work, i);
+		work(0);
+		for (auto &thread : threads)
+			thread.join();
+	}
+
+	void m_cancel() // workers stop after their current task
+	{
+		p_cancelled.store(true);
+		p_wake(true);
+	}
+	bool m_cancelled() const { return p_cancelled.load(std::memory_order_relaxed); }
+
+  private:
+	struct Queue
+	{
+		std::mutex m_mutex;
+		std::deque<Task> m_tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue>> p_queues;
+	std::atomic<size_t> p_pending{0}; // pushed but not finished yet
+	std::atomic<bool> p_cancelled{false};
+	std::mutex p_idle_mutex;
+	std::condition_variable p_idle;
+	std::atomic<uint64_t> p_signals{0}; // bumped by every push, the last task and m_cancel(), what sleepers wait for
+	std::atomic<unsigned> p_sleepers{0};
+
+	void p_wake(bool all)
+	{
+		p_signals.fetch_add(1);
+		if (p_sleepers.load() == 0) // seq_cst: either this sees the sleeper or the sleeper sees the new signal
+			return;
+		std::lock_guard<std::mutex> lock(p_idle_mutex); // a sleeper holds it until it's really waiting
+		if (all)
+			p_idle.notify_all();
+		else
+			p_idle.notify_one();
+	}
+
+	bool p_popOwn(unsigned worker, Task &task)
+	{
+		Queue &queue = *p_queues[worker];
+		std::lock_guard<std::mutex> lock(queue.m_mutex);
+		if (queue.m_tasks.empty())
+			return false;
+		task = std::move(queue.m_tasks.front());
+		queue.m_tasks.pop_front();
+		return true;
+	}
+
+	bool p_steal(unsigned worker, Task &task)
+	{
+		for (unsigned i = 1; i < m_threads(); i++)
+		{
+			Queue &victim = *p_queues[(worker + i) % m_threads()];
+			std::lock_guard<std::mutex> lock(victim.m_mutex);
+			if (victim.m_tasks.empty())
+				continue;
+			task = std::move(victim.m_tasks.back());
+			victim.m_tasks.pop_back();
+			return true;
+		}
+		return false;
+	}
+};
+
+#endif // workpool.hpp